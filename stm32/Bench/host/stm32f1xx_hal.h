@@ -0,0 +1,138 @@
+/*
+ * stm32f1xx_hal.h (host)
+ * Minimal stand-in for the HAL, enough to build the LCD driver on the host
+ *
+ * Interrupt-driven transfers are recorded and left pending: the test ends
+ * them with lcd_tx_complete(), as the I2C interrupt would. The blocking
+ * calls used by the speed probe succeed unless the address is marked
+ * absent, and the bus is never BUSY.
+ */
+
+#ifndef HOST_STM32F1XX_HAL_H_
+#define HOST_STM32F1XX_HAL_H_
+
+#include <stdint.h>
+#include <string.h>
+
+typedef enum { HAL_OK = 0, HAL_ERROR, HAL_BUSY, HAL_TIMEOUT } HAL_StatusTypeDef;
+
+typedef struct {
+    uint32_t ClockSpeed;
+    uint32_t DutyCycle;
+} I2C_InitTypeDef;
+
+typedef struct {
+    I2C_InitTypeDef Init;
+    uint32_t ErrorCode;
+} I2C_HandleTypeDef;
+
+typedef struct {
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+} GPIO_InitTypeDef;
+
+#define RESET                  0
+#define SET                    1
+#define I2C_FLAG_BUSY          1
+#define I2C_DUTYCYCLE_2        0
+#define HAL_I2C_ERROR_NONE     0x00u
+#define HAL_I2C_ERROR_BERR     0x01u
+#define HAL_I2C_ERROR_ARLO     0x02u
+#define HAL_I2C_ERROR_AF       0x04u
+#define HAL_I2C_ERROR_TIMEOUT  0x20u
+#define GPIOB                  0
+#define GPIO_PIN_8             0x0100u
+#define GPIO_PIN_9             0x0200u
+#define GPIO_PIN_RESET         0
+#define GPIO_PIN_SET           1
+#define GPIO_MODE_OUTPUT_OD    1
+#define GPIO_SPEED_FREQ_LOW    0
+
+// What the driver sent with interrupt-driven transfers
+#define HOST_I2C_LOG_SIZE  4096
+typedef struct {
+    uint32_t transfers;             // Transfers started
+    uint32_t bytes;                 // Bytes of those transfers
+    uint16_t last_len;              // Length of the latest transfer
+    uint8_t pending;                // Latest transfer not completed yet
+    uint16_t absent;                // Address that does not answer (0: none)
+    uint32_t log_len;               // Bytes in log (stops when full)
+    uint8_t log[HOST_I2C_LOG_SIZE]; // Every byte sent, in order
+} HostI2c;
+
+static HostI2c host_i2c;
+static uint32_t host_tick = 0;
+
+#define __HAL_I2C_GET_FLAG(h, f)  RESET
+
+static inline uint32_t __get_PRIMASK(void) { return 0; }
+static inline void __set_PRIMASK(uint32_t primask) { (void)primask; }
+static inline void __disable_irq(void) {}
+static inline void __enable_irq(void) {}
+
+static inline uint32_t HAL_GetTick(void) { return host_tick; }
+static inline void HAL_Delay(uint32_t ms) { host_tick += ms; }
+
+static inline void HAL_GPIO_Init(int port, GPIO_InitTypeDef *init) {
+    (void)port;
+    (void)init;
+}
+
+static inline void HAL_GPIO_WritePin(int port, uint32_t pin, int state) {
+    (void)port;
+    (void)pin;
+    (void)state;
+}
+
+static inline int HAL_GPIO_ReadPin(int port, uint32_t pin) {
+    (void)port;
+    (void)pin;
+    return GPIO_PIN_SET;
+}
+
+static inline HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c) {
+    hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+    return HAL_OK;
+}
+
+static inline HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c) {
+    (void)hi2c;
+    return HAL_OK;
+}
+
+static inline HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef *hi2c, uint16_t address,
+                                                      uint32_t trials, uint32_t timeout) {
+    (void)hi2c;
+    (void)trials;
+    (void)timeout;
+    return address == host_i2c.absent ? HAL_ERROR : HAL_OK;
+}
+
+static inline HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t address,
+                                                        uint8_t *data, uint16_t len, uint32_t timeout) {
+    (void)data;
+    (void)len;
+    (void)timeout;
+    hi2c->ErrorCode = address == host_i2c.absent ? HAL_I2C_ERROR_AF : HAL_I2C_ERROR_NONE;
+    return address == host_i2c.absent ? HAL_ERROR : HAL_OK;
+}
+
+static inline HAL_StatusTypeDef HAL_I2C_Master_Transmit_IT(I2C_HandleTypeDef *hi2c, uint16_t address,
+                                                           uint8_t *data, uint16_t len) {
+    (void)address;
+    if (host_i2c.pending) return HAL_BUSY;
+    hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+    host_i2c.transfers++;
+    host_i2c.bytes += len;
+    host_i2c.last_len = len;
+    host_i2c.pending = 1;
+    if (host_i2c.log_len + len <= HOST_I2C_LOG_SIZE) {
+        memcpy(&host_i2c.log[host_i2c.log_len], data, len);
+        host_i2c.log_len += len;
+    }
+    return HAL_OK;
+}
+
+#endif /* HOST_STM32F1XX_HAL_H_ */
@@ -0,0 +1,277 @@
+/*
+ * lcd_test.c
+ * Host test: what the LCD driver puts on the I2C bus for screen updates
+ *
+ * Builds Core/Src/i2c-lcd.c against the HAL stand-in in host/, which
+ * records every interrupt-driven transfer. Build and run on the host:
+ *
+ *   gcc -O2 -Wall -Ihost -I../Core/Inc -o lcd_test lcd_test.c ../Core/Src/lcd_text.c && ./lcd_test
+ */
+
+#include <stdio.h>
+#include "lcd_text.h"
+
+// Host build: no cycle counter
+#define PROF_ENABLE 0
+#define PROF_CYCLES() 0u
+
+#include "../Core/Src/i2c-lcd.c"
+
+I2C_HandleTypeDef hi2c1;
+
+static LcdHandle test_lcd;
+static uint32_t test_failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        test_failures++; \
+    } \
+} while (0)
+
+// One decoded command or character
+typedef struct {
+    uint8_t rs;     // 1 = character, 0 = command
+    uint8_t value;
+} TestFrame;
+
+/**
+ * @brief Complete transfers and run the service until the queue is empty
+ */
+static void test_flush(void) {
+    uint32_t wait;
+    uint16_t guard;
+
+    for (guard = 0; guard < 1000; guard++) {
+        wait = lcd_service();
+        if (host_i2c.pending) {
+            host_i2c.pending = 0;
+            lcd_tx_complete();
+            continue;
+        }
+        if (!lcd_busy() && lcd_ready(&test_lcd) && !test_lcd.lost &&
+            !test_lcd.dirty[0] && !test_lcd.dirty[1]) {
+            return;
+        }
+        host_tick += wait < LCD_BUS_WINDOW_MS ? wait : LCD_BUS_WINDOW_MS;
+    }
+    printf("queue did not drain\n");
+    test_failures++;
+}
+
+/**
+ * @brief Forget what was sent so far
+ */
+static void test_log_reset(void) {
+    host_i2c.transfers = 0;
+    host_i2c.bytes = 0;
+    host_i2c.log_len = 0;
+}
+
+/**
+ * @brief Decode the logged bytes into commands and characters
+ * Each nibble is latched by a byte with EN high; the idle bytes in
+ * between do not strobe. Only valid once the display is in 4-bit mode.
+ * @return Number of frames decoded
+ */
+static uint32_t test_decode(TestFrame *frames, uint32_t max) {
+    uint32_t count = 0;
+    uint8_t high = 0, half = 0;
+    uint32_t i;
+
+    for (i = 0; i < host_i2c.log_len && count < max; i++) {
+        uint8_t b = host_i2c.log[i];
+
+        if (!(b & 0x04)) continue;
+        if (!half) {
+            high = b & 0xF0;
+            half = 1;
+            continue;
+        }
+        frames[count].rs = b & 0x01;
+        frames[count].value = (uint8_t)(high | (b >> 4));
+        count++;
+        half = 0;
+    }
+    return count;
+}
+
+/**
+ * @brief Bring one display up and draw a first screen
+ * The display is missing at boot and connected later: the speed probe,
+ * one check per lcd_service() call, then runs again and picks the fastest
+ * clock instead of the fallback.
+ */
+static void test_setup(void) {
+    uint16_t i;
+
+    host_tick = 0;
+    host_i2c.absent = LCD_ADDRESS(0x21);
+    lcd_attach(&test_lcd, LCD_ADDRESS(0x21));
+    lcd_display_2lines(&test_lcd, "R:05  Y:--  G:--", "R:--  Y:--  G:09");
+    host_tick = LCD_POWER_ON_MS;
+    for (i = 0; i < 100 && lcd_bus_state == LCD_BUS_PROBE; i++) {
+        host_tick += lcd_service();
+    }
+    CHECK(lcd_headless(&test_lcd));
+    CHECK(lcd_get_bus_speed() == 50000);
+
+    host_i2c.absent = 0;
+    host_tick += LCD_REPROBE_MS;
+    test_flush();
+    CHECK(lcd_ready(&test_lcd));
+    CHECK(lcd_get_bus_speed() == 400000);
+}
+
+/**
+ * @brief Shadow framebuffer: only the cells that changed are sent
+ */
+static void test_shadow(void) {
+    TestFrame frames[64];
+    uint32_t n;
+
+    // The same screen again costs nothing
+    test_log_reset();
+    lcd_display_2lines(&test_lcd, "R:05  Y:--  G:--", "R:--  Y:--  G:09");
+    test_flush();
+    CHECK(host_i2c.bytes == 0);
+
+    // A countdown step: cursor to the digit, then the digit
+    test_log_reset();
+    lcd_display_2lines(&test_lcd, "R:04  Y:--  G:--", "R:--  Y:--  G:09");
+    test_flush();
+    n = test_decode(frames, 64);
+    CHECK(n == 2);
+    CHECK(frames[0].rs == 0 && frames[0].value == (0x80 | 3));
+    CHECK(frames[1].rs == 1 && frames[1].value == '4');
+
+    // Two changes one clean cell apart go out as one run
+    test_log_reset();
+    lcd_display_2lines(&test_lcd, "R:04  Y:--  G:--", "R:--  Y:--  X:19");
+    test_flush();
+    n = test_decode(frames, 64);
+    CHECK(n == 4);
+    CHECK(frames[0].rs == 0 && frames[0].value == (0x80 | 0x40 | 12));
+    CHECK(frames[1].rs == 1 && frames[1].value == 'X');
+    CHECK(frames[2].rs == 1 && frames[2].value == ':');
+    CHECK(frames[3].rs == 1 && frames[3].value == '1');
+
+    // Short lines are padded with spaces: "Y:--" and "G:--" are cleared,
+    // as two runs since two clean cells lie between them
+    test_log_reset();
+    lcd_display_2lines(&test_lcd, "R:04", "R:--  Y:--  X:19");
+    test_flush();
+    n = test_decode(frames, 64);
+    CHECK(n == 2 * (1 + 4));
+    CHECK(frames[0].rs == 0 && frames[0].value == (0x80 | 6));
+    CHECK(frames[5].rs == 0 && frames[5].value == (0x80 | 12));
+    CHECK(memcmp(test_lcd.shadow[0], "R:04            ", LCD_COLS) == 0);
+
+    // After lcd_invalidate() everything is redrawn: 2 cursors, 32 characters
+    // (in a fresh budget window, so no run is split)
+    host_tick += LCD_BUS_WINDOW_MS;
+    test_log_reset();
+    lcd_invalidate(&test_lcd);
+    test_flush();
+    n = test_decode(frames, 64);
+    CHECK(n == 2 + 2 * LCD_COLS);
+}
+
+/**
+ * @brief Coalescing: everything queued goes out in one transfer
+ */
+static void test_coalesce(void) {
+    // A countdown step is one transfer: cursor and digit, 8 bytes
+    test_log_reset();
+    lcd_display_2lines(&test_lcd, "R:03", "R:--  Y:--  X:19");
+    test_flush();
+    CHECK(host_i2c.transfers == 1);
+    CHECK(host_i2c.bytes == 2 * LCD_FRAME_SIZE);
+
+    // A full redraw at 400kHz fits one window's budget: one transfer of
+    // 34 frames when the frames do not wrap around the end of the queue
+    CHECK(lcd_get_bus_speed() == 400000);
+    lcd_queue_head = lcd_queue_tail = 0;
+    host_tick += LCD_BUS_WINDOW_MS;
+    test_log_reset();
+    lcd_invalidate(&test_lcd);
+    test_flush();
+    CHECK(host_i2c.transfers == 1);
+    CHECK(host_i2c.bytes == (2 + 2 * LCD_COLS) * LCD_FRAME_SIZE);
+
+    // Frames queued while a transfer is on the bus follow in one transfer
+    test_log_reset();
+    lcd_display_2lines(&test_lcd, "R:02", "R:--  Y:--  X:19");
+    lcd_service();
+    CHECK(host_i2c.pending && host_i2c.last_len == 2 * LCD_FRAME_SIZE);
+    lcd_display_2lines(&test_lcd, "Q:02", "R:--  Y:--  X:18");
+    lcd_service();
+    CHECK(host_i2c.transfers == 1);
+    host_i2c.pending = 0;
+    lcd_tx_complete();
+    CHECK(host_i2c.transfers == 2);
+    CHECK(host_i2c.last_len == 4 * LCD_FRAME_SIZE);
+    test_flush();
+    CHECK(host_i2c.transfers == 2);
+}
+
+/**
+ * @brief Big digits: glyphs are loaded first, then only changed cells move
+ */
+static void test_big_digits(void) {
+    TestFrame frames[128];
+    LcdLine line1, line2;
+    uint32_t n, i, data = 0;
+
+    // The glyph set goes to CGRAM; until then big digits cannot be shown
+    test_log_reset();
+    lcd_set_glyphs(lcd_text_big_glyphs, LCD_BIG_GLYPHS);
+    CHECK(!lcd_glyphs_ready(&test_lcd));
+    test_flush();
+    CHECK(lcd_glyphs_ready(&test_lcd));
+    n = test_decode(frames, 128);
+    CHECK(n > LCD_BIG_GLYPHS * 8);
+    CHECK(frames[0].rs == 0 && frames[0].value == 0x40);
+    for (i = 0; i < n; i++) {
+        if (!frames[i].rs) continue;
+        CHECK(data < LCD_BIG_GLYPHS * 8 &&
+              frames[i].value == lcd_text_big_glyphs[data / 8][data % 8]);
+        data++;
+    }
+    CHECK(data == LCD_BIG_GLYPHS * 8);
+
+    // Countdowns 25 and 35 as the FSM lays them out
+    memcpy(line1, "N       E       ", sizeof(line1));
+    memcpy(line2, "G       R       ", sizeof(line2));
+    lcd_text_put_big2(&line1[1], &line2[1], 25);
+    lcd_text_put_big2(&line1[9], &line2[9], 35);
+    lcd_display_2lines(&test_lcd, line1, line2);
+    test_flush();
+
+    // One tick later only the units digits change: 4 runs of 3 cells,
+    // in one transfer when they do not wrap around the end of the queue
+    lcd_queue_head = lcd_queue_tail = 0;
+    host_tick += LCD_BUS_WINDOW_MS;
+    test_log_reset();
+    lcd_text_put_big2(&line1[1], &line2[1], 24);
+    lcd_text_put_big2(&line1[9], &line2[9], 34);
+    lcd_display_2lines(&test_lcd, line1, line2);
+    test_flush();
+    n = test_decode(frames, 128);
+    CHECK(n == 4 * (1 + LCD_BIG_DIGIT_COLS));
+    CHECK(host_i2c.transfers == 1);
+}
+
+int main(void) {
+    test_setup();
+    test_shadow();
+    test_coalesce();
+    test_big_digits();
+
+    if (test_failures) {
+        printf("%lu check(s) failed\n", (unsigned long)test_failures);
+        return 1;
+    }
+    printf("lcd_test: all checks passed\n");
+    return 0;
+}
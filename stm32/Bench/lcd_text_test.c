@@ -0,0 +1,119 @@
+/*
+ * lcd_text_test.c
+ * Host test: number tables and big digits of Core/Src/lcd_text.c
+ *
+ * Build and run on the host:
+ *
+ *   gcc -O2 -Wall -Ihost -I../Core/Inc -o lcd_text_test lcd_text_test.c ../Core/Src/lcd_text.c && ./lcd_text_test
+ */
+
+#include <stdio.h>
+#include "lcd_text.h"
+
+static uint32_t test_failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        test_failures++; \
+    } \
+} while (0)
+
+#define TEST_FULL  ((char)0xFF)
+
+/**
+ * @brief Two-digit table and lcd_text_put2()
+ */
+static void test_digits(void) {
+    char slot[3] = {0};
+    char expect[3];
+    uint16_t v;
+
+    for (v = 0; v < 100; v++) {
+        snprintf(expect, sizeof(expect), "%02u", (unsigned)v);
+        lcd_text_put2(slot, (uint8_t)v);
+        CHECK(slot[0] == expect[0] && slot[1] == expect[1]);
+    }
+    lcd_text_put2(slot, 100);
+    CHECK(slot[0] == '*' && slot[1] == '*');
+}
+
+/**
+ * @brief Glyph bitmaps fit the 5x8 character cell
+ */
+static void test_glyphs(void) {
+    uint8_t g, row;
+
+    for (g = 0; g < LCD_BIG_GLYPHS; g++) {
+        for (row = 0; row < 8; row++) {
+            CHECK((lcd_text_big_glyphs[g][row] & ~0x1Fu) == 0);
+        }
+    }
+}
+
+/**
+ * @brief Big digits: valid character codes, all 10 distinct, every glyph used
+ */
+static void test_big_digits(void) {
+    char top[10][LCD_BIG_DIGIT_COLS];
+    char bottom[10][LCD_BIG_DIGIT_COLS];
+    char line1[8], line2[8];
+    uint8_t used = 0;
+    uint8_t d, e, c;
+
+    // Digit d as the units digit of 0d
+    for (d = 0; d < 10; d++) {
+        memset(line1, 'x', sizeof(line1));
+        memset(line2, 'x', sizeof(line2));
+        lcd_text_put_big2(line1, line2, d);
+        CHECK(line1[2 * LCD_BIG_DIGIT_COLS] == 'x' && line2[2 * LCD_BIG_DIGIT_COLS] == 'x');
+        memcpy(top[d], &line1[LCD_BIG_DIGIT_COLS], LCD_BIG_DIGIT_COLS);
+        memcpy(bottom[d], &line2[LCD_BIG_DIGIT_COLS], LCD_BIG_DIGIT_COLS);
+
+        // The tens digit of 0d is the same 0 every time
+        CHECK(memcmp(line1, top[0], LCD_BIG_DIGIT_COLS) == 0);
+
+        for (c = 0; c < LCD_BIG_DIGIT_COLS; c++) {
+            char cells[2] = { top[d][c], bottom[d][c] };
+            uint8_t k;
+
+            for (k = 0; k < 2; k++) {
+                // Never NUL: screen lines stay strings
+                CHECK(cells[k] == ' ' || cells[k] == TEST_FULL ||
+                      (cells[k] >= LCD_GLYPH(0) && cells[k] <= LCD_GLYPH(LCD_BIG_GLYPHS - 1)));
+                if (cells[k] >= LCD_GLYPH(0) && cells[k] <= LCD_GLYPH(LCD_BIG_GLYPHS - 1)) {
+                    used |= (uint8_t)(1u << (cells[k] - LCD_GLYPH(0)));
+                }
+            }
+        }
+    }
+    CHECK(used == (uint8_t)((1u << LCD_BIG_GLYPHS) - 1u));
+
+    for (d = 0; d < 10; d++) {
+        for (e = d + 1; e < 10; e++) {
+            CHECK(memcmp(top[d], top[e], LCD_BIG_DIGIT_COLS) != 0 ||
+                  memcmp(bottom[d], bottom[e], LCD_BIG_DIGIT_COLS) != 0);
+        }
+    }
+
+    // Tens digit in the first three columns; values above 99 show 99
+    lcd_text_put_big2(line1, line2, 47);
+    CHECK(memcmp(line1, top[4], LCD_BIG_DIGIT_COLS) == 0);
+    CHECK(memcmp(&line2[LCD_BIG_DIGIT_COLS], bottom[7], LCD_BIG_DIGIT_COLS) == 0);
+    lcd_text_put_big2(line1, line2, 200);
+    CHECK(memcmp(line1, top[9], LCD_BIG_DIGIT_COLS) == 0);
+    CHECK(memcmp(&line1[LCD_BIG_DIGIT_COLS], top[9], LCD_BIG_DIGIT_COLS) == 0);
+}
+
+int main(void) {
+    test_digits();
+    test_glyphs();
+    test_big_digits();
+
+    if (test_failures) {
+        printf("%lu check(s) failed\n", (unsigned long)test_failures);
+        return 1;
+    }
+    printf("lcd_text_test: all checks passed\n");
+    return 0;
+}
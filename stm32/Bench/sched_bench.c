@@ -0,0 +1,133 @@
+/*
+ * sched_bench.c
+ * Host benchmark: per-tick SCH_Advance() cost against task count
+ *
+ * Compares the delta-queue scheduler in Core/Src/sched.c with the previous
+ * linear scan over every task slot. Build and run on the host:
+ *
+ *   gcc -O2 -I../Core/Inc -o sched_bench sched_bench.c && ./sched_bench
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+// Host build: no interrupts to mask, no cycle counter, room for many tasks
+#define SCH_ENTER_CRITICAL()
+#define SCH_EXIT_CRITICAL()
+#define SCH_CLZ(x) ((uint32_t)__builtin_clz(x))
+#define PROF_ENABLE 0
+#define PROF_CYCLES() 0u
+#define SCH_MAX_TASKS 250
+
+#include "../Core/Src/sched.c"
+
+#define BENCH_TICKS 100000
+
+static volatile uint32_t bench_runs = 0;
+
+static void bench_task(void) {
+    bench_runs++;
+}
+
+/**
+ * @brief Previous scheduler: every slot is visited on every tick
+ */
+static sTask legacy_tasks[SCH_MAX_TASKS];
+
+static void legacy_update(uint32_t count) {
+    uint8_t Index;
+
+    for (Index = 0; Index < count; Index++) {
+        if (legacy_tasks[Index].pTask) {
+            if (legacy_tasks[Index].Delay > 0) {
+                legacy_tasks[Index].Delay--;
+            } else {
+                legacy_tasks[Index].RunMe = 1;
+                if (legacy_tasks[Index].Period > 0) {
+                    legacy_tasks[Index].Delay = legacy_tasks[Index].Period;
+                }
+            }
+        }
+    }
+}
+
+static void legacy_dispatch(uint32_t count) {
+    uint8_t Index;
+
+    for (Index = 0; Index < count; Index++) {
+        if (legacy_tasks[Index].RunMe > 0) {
+            (*legacy_tasks[Index].pTask)();
+            legacy_tasks[Index].RunMe = 0;
+        }
+    }
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/**
+ * @brief Time only the tick part; dispatch runs between ticks, untimed
+ * Every task has period `count` and its own offset, so exactly one task is
+ * released per tick whatever the task count (the old scan is sized to
+ * `count` slots, as if SCH_MAX_TASKS == count).
+ */
+static void bench_run(uint32_t count, double *delta_ns, double *legacy_ns) {
+    uint32_t i;
+    uint64_t t0, total;
+
+    SCH_Init();
+    for (i = 0; i < count; i++) {
+        SCH_Add_Task(bench_task, i, count);
+    }
+    total = 0;
+    for (i = 0; i < BENCH_TICKS; i++) {
+        t0 = now_ns();
+        SCH_Advance(1);
+        total += now_ns() - t0;
+        SCH_Dispatch_Tasks();
+    }
+    *delta_ns = (double)total / BENCH_TICKS;
+
+    for (i = 0; i < SCH_MAX_TASKS; i++) {
+        legacy_tasks[i].pTask = 0;
+        legacy_tasks[i].RunMe = 0;
+    }
+    for (i = 0; i < count; i++) {
+        legacy_tasks[i].pTask = bench_task;
+        legacy_tasks[i].Delay = i;
+        legacy_tasks[i].Period = count - 1;  // old reload gave Period + 1 ticks
+    }
+    total = 0;
+    for (i = 0; i < BENCH_TICKS; i++) {
+        t0 = now_ns();
+        legacy_update(count);
+        total += now_ns() - t0;
+        legacy_dispatch(count);
+    }
+    *legacy_ns = (double)total / BENCH_TICKS;
+}
+
+int main(void) {
+    static const uint32_t counts[] = {5, 10, 32, 64, 128, 250};
+    uint32_t i;
+    uint64_t t0, overhead = 0;
+    double delta_ns, legacy_ns;
+
+    // Cost of the timing calls themselves, subtracted from the results
+    for (i = 0; i < BENCH_TICKS; i++) {
+        t0 = now_ns();
+        overhead += now_ns() - t0;
+    }
+
+    printf("tasks  delta-queue ns/tick  linear-scan ns/tick\n");
+    for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        bench_run(counts[i], &delta_ns, &legacy_ns);
+        printf("%5lu  %19.1f  %19.1f\n", (unsigned long)counts[i],
+               delta_ns - (double)overhead / BENCH_TICKS,
+               legacy_ns - (double)overhead / BENCH_TICKS);
+    }
+    return 0;
+}
@@ -20,16 +20,45 @@
 #define BUTTON_RELEASED  0
 #define BUTTON_PRESSED   1
 
-// Debounce settings
-#define DEBOUNCE_TIME    5  // 50 cycles of 10ms = 500ms
+// GPIO ports the buttons may be spread over (one debouncer each)
+#define BUTTON_MAX_PORTS 3
 
-// Button press flags
-extern uint8_t button_flag[NUM_BUTTONS];
+// 1: EXTI edges start the button sampling, which stops again once all
+// buttons are released; 0: sample every tick
+#ifndef BUTTON_EXTI_WAKE
+#define BUTTON_EXTI_WAKE  1
+#endif
+
+// button_sampling() results
+#define BUTTON_SAMPLE_NONE  0  // All buttons watched by EXTI, nothing to sample
+#define BUTTON_SAMPLE_POLL  1  // Only buttons without an EXTI line need polling
+#define BUTTON_SAMPLE_TICK  2  // Sampling burst: sample every tick
+
+// Event timing (timer passes of 10ms)
+#define BUTTON_LONG_PRESS_TICKS    100  // Hold time for INPUT_EVENT_LONG (1s)
+#define BUTTON_DOUBLE_CLICK_TICKS  30   // Max gap between presses of a double click
+
+// Auto-repeat while held: first INPUT_EVENT_REPEAT after the delay, then the
+// interval shrinks by 1/BUTTON_REPEAT_ACCEL (at least 1) per repeat down to
+// the minimum. Defaults: 0.5s, then 200ms speeding up to 50ms within ~1s.
+#ifndef BUTTON_REPEAT_DELAY_TICKS
+#define BUTTON_REPEAT_DELAY_TICKS  50
+#endif
+#ifndef BUTTON_REPEAT_START_TICKS
+#define BUTTON_REPEAT_START_TICKS  20
+#endif
+#ifndef BUTTON_REPEAT_MIN_TICKS
+#define BUTTON_REPEAT_MIN_TICKS    5
+#endif
+#ifndef BUTTON_REPEAT_ACCEL
+#define BUTTON_REPEAT_ACCEL        4
+#endif
 
 // Function prototypes
 void button_init(void);
+void button_set_event_task(uint32_t handle);
 void button_reading(void);
-uint8_t is_button_pressed(uint8_t index);
-uint8_t is_button_long_pressed(uint8_t index);
+void button_exti(uint16_t pins);
+uint8_t button_sampling(void);
 
 #endif /* INC_BUTTON_H_ */
@@ -0,0 +1,40 @@
+/*
+ * debounce.h
+ * Bit-parallel input debouncer (vertical counters)
+ *
+ * Each input bit has its own 3-bit counter, stored "vertically" across
+ * three words: bit n of cnt[0..2] is the counter of input n. One update
+ * debounces all 32 bits of a word with a handful of logic operations,
+ * so the cost does not depend on the number of inputs.
+ */
+
+#ifndef INC_DEBOUNCE_H_
+#define INC_DEBOUNCE_H_
+
+#include "stm32f1xx_hal.h"
+
+// Consecutive samples an input must differ from its debounced state before
+// the state changes (1..7, 10ms samples)
+#ifndef DEBOUNCE_SAMPLES
+#define DEBOUNCE_SAMPLES  5
+#endif
+
+// Debounced inputs of one word (a GPIO port or a scanned matrix block)
+typedef struct {
+    GPIO_TypeDef *port;     // Port read by debounce_port() (0 for other sources)
+    uint32_t mask;          // Inputs debounced, other bits stay 0
+    uint32_t active_low;    // Inputs that are active when the pin reads 0
+    uint32_t state;         // Debounced state, 1 = active
+    uint32_t cnt[3];        // Vertical counters: samples differing from state
+    uint32_t pressed;       // Inputs that became active in the last update
+    uint32_t released;      // Inputs that became inactive in the last update
+} DebouncePort;
+
+// Function prototypes
+void debounce_init(DebouncePort *db, GPIO_TypeDef *port, uint32_t mask,
+                   uint32_t active_low);
+uint32_t debounce_update(DebouncePort *db, uint32_t raw);
+uint32_t debounce_port(DebouncePort *db);
+uint32_t debounce_busy(const DebouncePort *db);
+
+#endif /* INC_DEBOUNCE_H_ */
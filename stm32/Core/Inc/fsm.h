@@ -8,11 +8,17 @@
 
 #include "stm32f1xx_hal.h"
 
+// 1: AUTO NORM countdowns in 2-row big digits, 0: one text line per direction
+#ifndef FSM_LCD_BIG_DIGITS
+#define FSM_LCD_BIG_DIGITS  1
+#endif
+
 // Function prototypes
 void fsm_init(void);
 void fsm_run(void);
 void fsm_button_scan(void);
 void fsm_countdown_update(void);
+void fsm_lcd_service(void);
 void fsm_lcd_update(void);
 void fsm_flash_update(void);
 
@@ -3,18 +3,84 @@ Edit by modify: Ngoc Hang
 Modified for traffic light project
 **/
 
+#ifndef INC_I2C_LCD_H_
+#define INC_I2C_LCD_H_
+
 #include "stm32f1xx_hal.h"
 
-void lcd_init (void);   // initialize lcd
+#define LCD_ROWS 2	// screen geometry
+#define LCD_COLS 16
+
+#define LCD_ADDRESS(addr7) ((uint16_t)((addr7) << 1))	// PCF8574 7-bit address as HAL expects it
+
+/* One display on the bus (fields are managed by the driver) */
+typedef struct LcdHandle {
+	uint16_t address;	// I2C address (LCD_ADDRESS)
+	char text[LCD_ROWS][LCD_COLS];	// content to show
+	char shadow[LCD_ROWS][LCD_COLS];	// content on the screen
+	uint16_t dirty[LCD_ROWS];	// cells still to send, one bit per column
+	volatile uint8_t state;	// initialisation progress, headless
+	volatile uint8_t lost;	// frames were dropped: redraw everything
+	uint8_t error_run;	// failed transfers in a row
+	uint8_t glyph_next;	// first custom glyph not loaded yet
+	uint32_t due;	// HAL tick of the next init step or presence check
+	struct LcdHandle *next;	// next display on the bus
+} LcdHandle;
+
+typedef struct {
+	uint32_t transfers;	// completed I2C transfers (one start + address each)
+	uint32_t bytes;	// bytes sent (4 per command/character)
+	uint32_t busy_cycles;	// CPU cycles with a transfer in flight (0 if PROF_ENABLE is 0)
+	uint32_t errors;	// failed I2C transfers
+	uint32_t headless;	// times a display was found missing
+	uint32_t recoveries;	// bus recoveries started (SCL pulses + STOP + peripheral reset)
+	uint32_t recover_failures;	// recoveries after which the bus was still busy
+} LcdBusStats;
+
+#ifndef LCD_I2C_SPEED_MAX
+#define LCD_I2C_SPEED_MAX 400000	// fastest I2C clock tried by the speed probe (Hz)
+#endif
+
+#ifndef LCD_ERROR_LIMIT
+#define LCD_ERROR_LIMIT 3	// failed transfers in a row before going headless
+#endif
+
+#ifndef LCD_REPROBE_MS
+#define LCD_REPROBE_MS 1000	// presence check interval while headless (ms)
+#endif
+
+#ifndef LCD_BUS_BUDGET_US
+#define LCD_BUS_BUDGET_US 5000	// bus time the refresh of all displays may fill per 10ms
+#endif
+
+#ifndef LCD_QUEUE_SIZE
+#define LCD_QUEUE_SIZE 256	// transmit queue in bytes (power of 2, 4 bytes per command/character)
+#endif
+
+void lcd_attach (LcdHandle *hlcd, uint16_t address);	// add a display to the bus, initialised by lcd_service
+
+uint32_t lcd_service (void);	// init, presence checks, recovery and refresh: call again after the returned ms
+
+uint8_t lcd_ready (LcdHandle *hlcd);	// 1 once initialisation has been queued
+
+uint8_t lcd_headless (LcdHandle *hlcd);	// 1 while the lcd is missing and its traffic is dropped
+
+uint32_t lcd_get_bus_speed (void);	// I2C clock the bus runs at (Hz)
+
+void lcd_display_2lines (LcdHandle *hlcd, const char* line1, const char* line2); // set 2 lines of text, changes are sent by lcd_service
+
+void lcd_set_glyphs (const uint8_t (*glyphs)[8], uint8_t count);	// custom characters 0..count-1 (max 8) of every lcd, loaded at every init
+
+uint8_t lcd_glyphs_ready (LcdHandle *hlcd);	// 1 while the custom characters are loaded (0 again after a re-init)
 
-void lcd_send_cmd (char cmd);  // send command to the lcd
+void lcd_invalidate (LcdHandle *hlcd);	// force a full redraw
 
-void lcd_send_data (char data);  // send data to the lcd
+void lcd_get_bus_stats (LcdBusStats *stats);	// I2C traffic caused by the displays
 
-void lcd_send_string (char *str);  // send string to the lcd
+uint8_t lcd_busy (void);	// 1 while queued commands/characters are still being sent
 
-void lcd_clear_display (void);	//clear display lcd
+void lcd_tx_complete (void);	// I2C transfer done, from HAL_I2C_MasterTxCpltCallback
 
-void lcd_goto_XY (int row, int col); //set proper location on screen
+void lcd_tx_error (void);	// I2C transfer failed, from HAL_I2C_ErrorCallback
 
-void lcd_display_2lines(char* line1, char* line2); // display 2 lines of text
+#endif /* INC_I2C_LCD_H_ */
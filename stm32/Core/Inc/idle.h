@@ -0,0 +1,40 @@
+/*
+ * idle.h
+ * Tickless idle: sleep (WFI) between scheduler and software timer deadlines
+ */
+
+#ifndef INC_IDLE_H_
+#define INC_IDLE_H_
+
+#include "stm32f1xx_hal.h"
+
+// Longest tickless sleep in 10ms ticks (also limited by the 16-bit TIM2)
+#ifndef IDLE_MAX_TICKS
+#define IDLE_MAX_TICKS         100
+#endif
+
+// Sampling interval while idle for buttons that cannot wake the core by
+// EXTI (their line is taken), in 10ms ticks. A larger value delays (or
+// misses) short presses on those buttons. Buttons with an EXTI line do
+// not limit the sleep; during a debounce burst the limit is 1 tick.
+#ifndef IDLE_INPUT_POLL_TICKS
+#define IDLE_INPUT_POLL_TICKS  5
+#endif
+
+// Length of the statistics window (1 second)
+#define IDLE_WINDOW_TICKS      100
+
+// Sleep statistics
+typedef struct {
+    uint32_t wakeups;          // Total wakeups from WFI
+    uint32_t sleep_ms;         // Total time spent asleep
+    uint16_t wakeups_per_s;    // Wakeups during the last full second
+    uint16_t sleep_permille;   // Share of the last full second spent asleep
+} IdleStats;
+
+// Function prototypes
+void idle_init(void);
+void idle_enter(void);
+void idle_get_stats(IdleStats *stats);
+
+#endif /* INC_IDLE_H_ */
@@ -0,0 +1,39 @@
+/*
+ * input_event.h
+ * Input event queue (single producer, single consumer)
+ *
+ * The debounce path posts timestamped events, the FSM input task drains
+ * them. Producer and consumer each own one index, so no locking is needed
+ * between the timer pass (or an interrupt) and the task.
+ */
+
+#ifndef INC_INPUT_EVENT_H_
+#define INC_INPUT_EVENT_H_
+
+#include <stdint.h>
+
+// Queue length in events (power of 2)
+#ifndef INPUT_EVENT_QUEUE_SIZE
+#define INPUT_EVENT_QUEUE_SIZE  32
+#endif
+
+// Event types
+#define INPUT_EVENT_PRESS    0  // Debounced press
+#define INPUT_EVENT_RELEASE  1  // Debounced release
+#define INPUT_EVENT_LONG     2  // Held for the long-press time (once per press)
+#define INPUT_EVENT_REPEAT   3  // Held: first after the repeat delay, then faster (see button.h)
+#define INPUT_EVENT_DOUBLE   4  // Second press within the double-click time
+
+typedef struct {
+    uint32_t time;      // Tick (10ms) the event was detected
+    uint8_t input;      // Input index (BUTTON_* for the buttons)
+    uint8_t type;       // INPUT_EVENT_*
+} InputEvent;
+
+// Function prototypes
+void input_event_init(void);
+uint8_t input_event_post(uint8_t input, uint8_t type, uint32_t time);
+uint8_t input_event_get(InputEvent *event);
+uint32_t input_event_dropped(void);
+
+#endif /* INC_INPUT_EVENT_H_ */
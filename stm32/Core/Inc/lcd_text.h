@@ -0,0 +1,59 @@
+/*
+ * lcd_text.h
+ * printf-free text formatting for the 16x2 LCD
+ *
+ * A screen line is a constant template of LCD_COLS characters; numbers
+ * are patched into fixed slots of a copy. Two-digit values come from a
+ * lookup table, so a countdown line costs one copy and two byte stores.
+ * Two-row big digits are built the same way from glyph tables.
+ */
+
+#ifndef INC_LCD_TEXT_H_
+#define INC_LCD_TEXT_H_
+
+#include <stdint.h>
+#include <string.h>
+#include "i2c-lcd.h"
+
+// One screen line and its terminating NUL
+typedef char LcdLine[LCD_COLS + 1];
+
+// "00" to "99" as character pairs
+extern const char lcd_text_digits[100][2];
+
+/**
+ * @brief Copy a line template into a buffer
+ * @param line: Destination buffer
+ * @param template: Template (LCD_COLS characters, NUL padded)
+ */
+static inline void lcd_text_load(char *line, const char *template) {
+    memcpy(line, template, sizeof(LcdLine));
+}
+
+/**
+ * @brief Write a number as two digits (with leading zero)
+ * @param slot: First of the two characters to overwrite
+ * @param value: Number to write, values above 99 show as "**"
+ */
+static inline void lcd_text_put2(char *slot, uint8_t value) {
+    if (value > 99) {
+        slot[0] = '*';
+        slot[1] = '*';
+        return;
+    }
+    slot[0] = lcd_text_digits[value][0];
+    slot[1] = lcd_text_digits[value][1];
+}
+
+// Big digits, 3 columns by 2 rows, drawn with 8 custom glyphs. The glyphs
+// are used through character codes 8-15 (CGRAM 0-7 repeated), so lines
+// stay NUL-terminated strings.
+#define LCD_BIG_DIGIT_COLS  3
+#define LCD_BIG_GLYPHS      8
+#define LCD_GLYPH(n)        ((char)(8 + (n)))
+
+extern const uint8_t lcd_text_big_glyphs[LCD_BIG_GLYPHS][8];
+
+void lcd_text_put_big2(char *top, char *bottom, uint8_t value);
+
+#endif /* INC_LCD_TEXT_H_ */
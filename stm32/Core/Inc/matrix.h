@@ -0,0 +1,69 @@
+/*
+ * matrix.h
+ * Scanned input matrix (pedestrian push-buttons, detector contacts)
+ *
+ * Rows are driven low one at a time (open-drain), columns are read with
+ * pull-ups, so a closed contact reads 0 in its row's sample. The samples
+ * are debounced with the bit-parallel debouncer and posted to the input
+ * event queue as press/release events of inputs MATRIX_INPUT_BASE + n,
+ * n = row * MATRIX_COLS + column.
+ */
+
+#ifndef INC_MATRIX_H_
+#define INC_MATRIX_H_
+
+#include "stm32f1xx_hal.h"
+#include "button.h"
+
+// 1: scan the matrix every tick (no matrix is wired on the stock board)
+#ifndef MATRIX_ENABLE
+#define MATRIX_ENABLE  0
+#endif
+
+// 1: TIM3 + DMA1 scan the rows in the background into a buffer
+// (channel 3 writes the row pattern, channel 6 reads the columns);
+// 0: the CPU drives and reads each row in matrix_scan()
+#ifndef MATRIX_USE_DMA
+#define MATRIX_USE_DMA  1
+#endif
+
+// Geometry (MATRIX_ROWS x MATRIX_COLS <= 64 contacts)
+#ifndef MATRIX_ROWS
+#define MATRIX_ROWS  8
+#endif
+#ifndef MATRIX_COLS
+#define MATRIX_COLS  4
+#endif
+
+// Rows on consecutive pins of one port, columns on consecutive pins of another
+#ifndef MATRIX_ROW_PORT
+#define MATRIX_ROW_PORT    GPIOC
+#define MATRIX_ROW_SHIFT   0    // PC0..PC7
+#endif
+#ifndef MATRIX_COL_PORT
+#define MATRIX_COL_PORT    GPIOB
+#define MATRIX_COL_SHIFT   12   // PB12..PB15
+#endif
+
+// Time each row is driven in DMA mode (us); columns are read halfway
+#ifndef MATRIX_ROW_US
+#define MATRIX_ROW_US  100
+#endif
+
+// Delay between driving a row and reading the columns in CPU mode
+// (busy-wait loop iterations, ~3 cycles each)
+#ifndef MATRIX_SETTLE_LOOPS
+#define MATRIX_SETTLE_LOOPS  20
+#endif
+
+// First input index of the matrix in the input event queue
+#define MATRIX_INPUT_BASE  NUM_BUTTONS
+#define MATRIX_INPUTS      (MATRIX_ROWS * MATRIX_COLS)
+
+// Function prototypes
+void matrix_init(void);
+void matrix_set_event_task(uint32_t handle);
+void matrix_scan(void);
+uint8_t matrix_sampling(void);
+
+#endif /* INC_MATRIX_H_ */
@@ -0,0 +1,64 @@
+/*
+ * prof.h
+ * Execution-time profiling with the DWT cycle counter
+ */
+
+#ifndef INC_PROF_H_
+#define INC_PROF_H_
+
+#include <stdint.h>
+
+// Set to 0 to compile all profiling out
+#ifndef PROF_ENABLE
+#define PROF_ENABLE 1
+#endif
+
+// Cycle counter read (can be overridden before including, e.g. on the host)
+#ifndef PROF_CYCLES
+#include "stm32f1xx_hal.h"
+#define PROF_CYCLES()  (DWT->CYCCNT)
+#endif
+
+// Execution-time statistics (cycles)
+typedef struct {
+    uint32_t count;   // Number of samples
+    uint32_t min;     // Shortest sample
+    uint32_t max;     // Longest sample
+    uint64_t total;   // Sum of all samples (mean = total / count)
+} ProfStats;
+
+// TIM2 interrupt statistics
+extern ProfStats prof_tick_isr;
+
+/**
+ * @brief Add one sample to a statistics record
+ * @param stats: Record to update
+ * @param cycles: Measured cycles
+ */
+static inline void prof_record(ProfStats *stats, uint32_t cycles) {
+    if (cycles < stats->min) stats->min = cycles;
+    if (cycles > stats->max) stats->max = cycles;
+    stats->total += cycles;
+    stats->count++;
+}
+
+/**
+ * @brief Clear a statistics record
+ * @param stats: Record to clear
+ */
+static inline void prof_reset(ProfStats *stats) {
+    stats->count = 0;
+    stats->min = 0xFFFFFFFFu;
+    stats->max = 0;
+    stats->total = 0;
+}
+
+// Function prototypes
+void prof_init(void);
+uint32_t prof_mean(const ProfStats *stats);
+void prof_get_isr_stats(ProfStats *stats);
+void prof_request_dump(void);
+void prof_service(void);
+void prof_dump(void);
+
+#endif /* INC_PROF_H_ */
@@ -1,30 +1,103 @@
 /*
  * sched.h
  * Task scheduler for cooperative multitasking
+ *
+ * Pending tasks are kept in a delta queue: a linked list sorted by due
+ * time where each entry stores the ticks remaining after its predecessor.
+ * SCH_Advance() only decrements the head and moves due tasks to a ready
+ * list, so the tick cost does not depend on the number of tasks. Ready
+ * tasks are dispatched highest priority first. Event tasks are not timed
+ * at all: they are released by SCH_Signal(), e.g. from an input ISR.
+ *
+ * Tasks are named by handles: slot index in bits 0-7, slot generation in
+ * bits 8-31. A handle stays valid until its task is deleted (a one-shot
+ * task is deleted after it runs); stale handles are rejected.
  */
 
 #ifndef INC_SCHED_H_
 #define INC_SCHED_H_
 
 #include <stdint.h>
+#include "prof.h"
 
-// Maximum number of tasks
-#define SCH_MAX_TASKS 10
+// Maximum number of tasks (slot indices are 8-bit and 0xFF is SCH_NO_TASK,
+// so at most 254)
+#ifndef SCH_MAX_TASKS
+#define SCH_MAX_TASKS 32
+#endif
+
+// End-of-list marker for the delta queue and ready lists
+#define SCH_NO_TASK   0xFF
+
+_Static_assert(SCH_MAX_TASKS < SCH_NO_TASK, "SCH_MAX_TASKS must be at most 254");
+
+// Task handles
+#define SCH_INVALID_HANDLE        0u
+#define SCH_GEN_MASK              0x00FFFFFFu
+#define SCH_HANDLE(slot, gen)     (((uint32_t)(gen) << 8) | (uint32_t)(slot))
+#define SCH_HANDLE_SLOT(handle)   ((uint8_t)((handle) & 0xFFu))
+
+// Task priorities: 0 is the most urgent
+#define SCH_PRIORITIES    32
+#define SCH_PRIO_HIGHEST  0
+#define SCH_PRIO_DEFAULT  16
+#define SCH_PRIO_LOWEST   (SCH_PRIORITIES - 1)
 
 // Task structure
 typedef struct {
     void (*pTask)(void);  // Pointer to the task function
-    uint32_t Delay;       // Delay (ticks) until the task will run
+    uint32_t Delay;       // Ticks after the previous entry in the delta queue
     uint32_t Period;      // Period (ticks) between repeated runs
-    uint8_t RunMe;        // Flag indicating task is ready to run
-    uint32_t TaskID;      // Task identifier
+    uint32_t Due;         // Absolute tick of the pending release
+    uint8_t RunMe;        // Flag indicating task is ready to run (in a ready list)
+    uint8_t Queued;       // Waiting in the delta queue
+    uint8_t Priority;     // Dispatch priority (0 = highest)
+    uint8_t Event;        // Released by SCH_Signal() instead of the tick
+    uint8_t Next;         // Next slot in the delta queue or ready list
+    uint8_t Prev;         // Previous slot in the delta queue or ready list
+    uint32_t Handle;      // Task handle (SCH_INVALID_HANDLE if the slot is free)
+    uint32_t Generation;  // Bumped each time the slot is reused
 } sTask;
 
+// Static task description (const, placed in flash), see task_manifest.h
+typedef struct {
+    void (*pTask)(void);  // Pointer to the task function
+    uint32_t Delay;       // Initial delay (ticks)
+    uint32_t Period;      // Period (ticks), 0 for one-shot
+    uint8_t Priority;     // Dispatch priority (0 = highest)
+    uint8_t Event;        // 1 = released by SCH_Signal() only
+} sTaskConfig;
+
+// Dispatch latency histogram: bucket k counts latencies below
+// 2^k units of 2^SCH_HIST_SHIFT cycles (1 unit = 1us at 64 MHz)
+#define SCH_HIST_BUCKETS  16
+#define SCH_HIST_SHIFT    6
+
+// Release jitter statistics
+typedef struct {
+    uint16_t Bucket[SCH_HIST_BUCKETS];  // Latency histogram (saturating)
+    uint32_t MaxLatency;                // Longest release-to-start (cycles)
+    uint32_t Missed;                    // Releases skipped because the task ran late
+} sTaskJitter;
+
 // Function prototypes
 void SCH_Init(void);
+void SCH_Load_Table(const sTaskConfig *table, uint8_t count);
 uint32_t SCH_Add_Task(void (*pFunction)(), uint32_t DELAY, uint32_t PERIOD);
-void SCH_Update(void);
+uint32_t SCH_Add_Task_Priority(void (*pFunction)(), uint32_t DELAY, uint32_t PERIOD,
+                               uint8_t PRIORITY);
+uint32_t SCH_Add_Event_Task(void (*pFunction)(), uint8_t PRIORITY);
+uint8_t SCH_Signal(uint32_t handle);
+uint8_t SCH_Reschedule_Task(uint32_t handle, uint32_t DELAY);
+uint8_t SCH_Set_Period(uint32_t handle, uint32_t PERIOD);
+uint8_t SCH_Get_Task_Info(uint32_t handle, uint32_t *remaining, uint32_t *period);
+void SCH_Advance(uint32_t ticks);
+void SCH_Advance_Stamped(uint32_t ticks, uint32_t stamp);
+uint32_t SCH_Next_Due(void);
 void SCH_Dispatch_Tasks(void);
-uint8_t SCH_Delete_Task(uint32_t taskID);
+uint8_t SCH_Delete_Task(uint32_t handle);
+uint8_t SCH_Get_Task_Stats(uint8_t index, void (**pTask)(void), ProfStats *stats);
+uint8_t SCH_Get_Task_Jitter(uint8_t index, sTaskJitter *jitter);
+void SCH_Reset_Stats(void);
 
 #endif /* INC_SCHED_H_ */
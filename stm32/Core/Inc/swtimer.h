@@ -0,0 +1,45 @@
+/*
+ * swtimer.h
+ * Software timer service based on a hierarchical timing wheel
+ *
+ * Timers are caller-owned structures, so their number is limited only by
+ * RAM. Start and stop are O(1); SWT_Advance() only counts ticks and the
+ * wheel is caught up by SWT_Dispatch(), where callbacks run.
+ */
+
+#ifndef INC_SWTIMER_H_
+#define INC_SWTIMER_H_
+
+#include <stdint.h>
+
+// Wheel geometry: SWT_LEVELS levels of 2^SWT_SLOT_BITS slots each.
+// With 4 x 64 slots, delays up to 2^24 ticks (~46 hours at 10ms) are exact;
+// longer delays are clamped.
+#define SWT_SLOT_BITS  6
+#define SWT_SLOTS      (1u << SWT_SLOT_BITS)
+#define SWT_SLOT_MASK  (SWT_SLOTS - 1u)
+#define SWT_LEVELS     4
+#define SWT_MAX_DELAY  ((1u << (SWT_SLOT_BITS * SWT_LEVELS)) - 1u)
+
+// Software timer structure (owned by the caller, do not modify directly)
+typedef struct sSoftTimer {
+    struct sSoftTimer *next;        // Next timer in the same wheel slot
+    struct sSoftTimer **pprev;      // Link pointing at this timer (0 if idle)
+    uint32_t Expires;               // Absolute tick of the next expiry
+    uint32_t Period;                // Reload (ticks), 0 for one-shot
+    void (*pCallback)(void *arg);   // Called from SWT_Dispatch()
+    void *arg;                      // Argument passed to the callback
+} sSoftTimer;
+
+// Function prototypes
+void SWT_Init(void);
+void SWT_Start(sSoftTimer *timer, void (*pCallback)(void *), void *arg,
+               uint32_t DELAY, uint32_t PERIOD);
+uint8_t SWT_Stop(sSoftTimer *timer);
+uint8_t SWT_Is_Active(const sSoftTimer *timer);
+uint32_t SWT_Get_Tick(void);
+void SWT_Advance(uint32_t ticks);
+uint32_t SWT_Next_Expiry(void);
+void SWT_Dispatch(void);
+
+#endif /* INC_SWTIMER_H_ */
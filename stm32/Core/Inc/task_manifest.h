@@ -0,0 +1,41 @@
+/*
+ * task_manifest.h
+ * Compile-time list of the application's scheduler tasks
+ *
+ * Each entry is TASK(name, function, delay, period, priority, event), with
+ * delay and period in 10ms ticks and priority 0 (highest) .. 31. Event
+ * tasks are released by SCH_Signal() and must have delay and period 0.
+ * The list expands to a const table in flash (task_manifest.c), to the
+ * TASK_<name> slot indices (and TASK_HANDLE(name) handles) and to
+ * build-time checks of every entry.
+ */
+
+#ifndef INC_TASK_MANIFEST_H_
+#define INC_TASK_MANIFEST_H_
+
+#include "sched.h"
+
+#define TASK_MANIFEST(TASK) \
+    TASK(COUNTDOWN,   fsm_countdown_update, 100, 100,  2, 0) /* Countdown every 1 second */ \
+    TASK(BUTTON_SCAN, fsm_button_scan,        0,   0,  4, 1) /* Button handling on press */ \
+    TASK(FSM_RUN,     fsm_run,                0, 100,  6, 0) /* FSM run every 1 second */ \
+    TASK(FLASH,       fsm_flash_update,      50,  50,  8, 0) /* Flash update every 500ms */ \
+    TASK(LCD_SERVICE, fsm_lcd_service,        0,   0, 10, 0) /* LCD init, presence checks, refresh; reschedules itself */ \
+    TASK(LCD,         fsm_lcd_update,         0,  10, 12, 0) /* LCD update every 100ms */ \
+    TASK(PROF,        prof_service,         100, 100, SCH_PRIO_LOWEST, 0) /* Profiling dump on request */
+
+// Slot index of each manifest task
+#define TASK_INDEX(name, function, delay, period, priority, event)  TASK_##name,
+typedef enum {
+    TASK_MANIFEST(TASK_INDEX)
+    TASK_COUNT
+} TaskIndex;
+#undef TASK_INDEX
+
+// Scheduler handle of a manifest task (valid after SCH_Load_Table())
+#define TASK_HANDLE(name)  SCH_HANDLE(TASK_##name, 1)
+
+// Task table, loaded with SCH_Load_Table(task_table, TASK_COUNT)
+extern const sTaskConfig task_table[TASK_COUNT];
+
+#endif /* INC_TASK_MANIFEST_H_ */
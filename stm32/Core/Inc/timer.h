@@ -7,6 +7,7 @@
 #define INC_TIMER_H_
 
 #include "stm32f1xx_hal.h"
+#include "prof.h"
 
 // Timer flags for different subsystems
 extern uint8_t timer_flag_10ms;
@@ -15,9 +16,30 @@ extern uint8_t timer_flag_1s;
 // Timer counter
 extern uint16_t timer_counter_1s;
 
+// Ticks counted by the TIM2 interrupt (wraps), and ticks the next
+// interrupt represents (more than 1 in tickless idle)
+extern volatile uint32_t timer_ticks;
+extern volatile uint32_t timer_period_ticks;
+
+// Cycle counter when timer_ticks last changed (set by the TIM2 interrupt
+// in PROF_ENABLE builds), to measure task release latency from the tick
+extern volatile uint32_t timer_tick_cycles;
+
+/**
+ * @brief Count the elapsed tick(s) - the only work done in the TIM2 interrupt
+ */
+static inline void timer_run(void) {
+    timer_ticks += timer_period_ticks;
+    timer_period_ticks = 1;
+}
+
 // Function prototypes
 void timer_init(void);
-void timer_run(void);
+void timer_process(void);
+uint32_t timer_pending(void);
+void timer_add_ticks(uint32_t ticks);
+void timer_advance(uint32_t ticks, uint32_t stamp);
+void timer_set_period_ticks(uint32_t ticks);
 void setTimer(uint8_t* flag, uint16_t duration);
 
 #endif /* INC_TIMER_H_ */
@@ -1,153 +1,304 @@
 /*
  * button.c
  * Button handling implementation with debouncing
- * Supports 4 buttons with press detection
+ * Supports 4 buttons with press, release, long-press, accelerating
+ * auto-repeat and double-click events, queued in input_event.c. Every queued event signals
+ * the registered scheduler event task, so the input handler only runs when
+ * there is input. Debouncing reads each GPIO port once per tick (debounce.c),
+ * only while an EXTI edge has started a sampling burst (BUTTON_EXTI_WAKE).
  */
 
 #include "button.h"
+#include "debounce.h"
+#include "input_event.h"
 #include "main.h"
+#include "sched.h"
+#include "swtimer.h"
 
-// Button GPIO pins (will be defined in main.h after GPIO config)
-// Using these pins (avoiding already-in-use pins):
-// BUTTON_1_MOD1: PB8
-// BUTTON_2_MOD1: PB9
-// BUTTON_1_MOD2: PB10
-// BUTTON_2_MOD2: PB11
+#if BUTTON_REPEAT_DELAY_TICKS < 1 || BUTTON_REPEAT_MIN_TICKS < 1 || \
+    BUTTON_REPEAT_START_TICKS < BUTTON_REPEAT_MIN_TICKS || BUTTON_REPEAT_ACCEL < 1
+#error "Invalid BUTTON_REPEAT_* settings"
+#endif
 
-// Button state arrays
-static uint8_t button_current[NUM_BUTTONS] = {BUTTON_RELEASED};
-static uint8_t button_last[NUM_BUTTONS] = {BUTTON_RELEASED};
-static uint8_t button_stable[NUM_BUTTONS] = {BUTTON_RELEASED};
-static uint8_t button_debounce_counter[NUM_BUTTONS] = {0};
+// Button pins, indexed like the BUTTON_* defines (pull-up, pressed = LOW)
+typedef struct {
+    GPIO_TypeDef *port;
+    uint16_t pin;
+} ButtonPin;
 
-// Button press flags (set when button is pressed, cleared after read)
-uint8_t button_flag[NUM_BUTTONS] = {0};
+static const ButtonPin button_pins[NUM_BUTTONS] = {
+    { Button_1_GPIO_Port, Button_1_Pin },   // BUTTON_1_MOD1
+    { Button_2_GPIO_Port, Button_2_Pin },   // BUTTON_2_MOD1
+    { Button_3_GPIO_Port, Button_3_Pin },   // BUTTON_1_MOD2
+    { Button_4_GPIO_Port, Button_4_Pin },   // BUTTON_2_MOD2
+};
 
-// Long press counters (in 10ms units, 100 = 1 second)
-static uint16_t button_long_press_counter[NUM_BUTTONS] = {0};
-static uint8_t button_long_press_flag[NUM_BUTTONS] = {0};
+// One debouncer per GPIO port used by the buttons; each port is read once
+// per tick and all its buttons are debounced together
+static DebouncePort button_ports[BUTTON_MAX_PORTS];
+static uint8_t button_port_count = 0;
+static uint8_t button_port_index[NUM_BUTTONS];
+
+// Hold counters (timer passes since the press, saturating), passes left
+// until the next auto-repeat and the current repeat interval
+static uint16_t button_hold_counter[NUM_BUTTONS] = {0};
+static uint16_t button_repeat_wait[NUM_BUTTONS] = {0};
+static uint16_t button_repeat_interval[NUM_BUTTONS] = {0};
+
+// Tick of the last press that can still start a double click
+static uint32_t button_last_press[NUM_BUTTONS] = {0};
+static uint8_t button_double_armed[NUM_BUTTONS] = {0};
+
+// Scheduler event task released on every queued input event
+static uint32_t button_event_task = SCH_INVALID_HANDLE;
+
+#if BUTTON_EXTI_WAKE
+// EXTI lines owned by buttons; buttons whose line is taken (by B1 or a
+// button on another port) are polled instead
+static uint16_t button_exti_lines = 0;
+static uint32_t button_poll_mask[BUTTON_MAX_PORTS];
+static uint8_t button_polled = 0;
+
+// Set by an EXTI edge; the burst samples every pass until all buttons
+// are released and settled again
+static volatile uint8_t button_wake = 0;
+static uint8_t button_burst = 0;
+
+/**
+ * @brief Route a button pin to its EXTI line (falling edge = press)
+ * @return 1 if the pin got the line, 0 if the line is already in use
+ */
+static uint8_t button_exti_setup(GPIO_TypeDef *port, uint16_t pin) {
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+    IRQn_Type irq;
+    uint8_t line = 0;
+
+    if ((button_exti_lines | B1_Pin) & pin) return 0;
+
+    while ((pin >> line) != 1u) line++;
+    if (line <= 4) {
+        irq = (IRQn_Type)(EXTI0_IRQn + line);
+    } else if (line <= 9) {
+        irq = EXTI9_5_IRQn;
+    } else {
+        irq = EXTI15_10_IRQn;
+    }
+
+    GPIO_InitStruct.Pin = pin;
+    GPIO_InitStruct.Mode = GPIO_MODE_IT_FALLING;
+    GPIO_InitStruct.Pull = GPIO_PULLUP;
+    HAL_GPIO_Init(port, &GPIO_InitStruct);
+    if (irq != EXTI15_10_IRQn) {
+        // EXTI15_10 is shared with B1 and already set up in main.c
+        HAL_NVIC_SetPriority(irq, 2, 0);
+        HAL_NVIC_EnableIRQ(irq);
+    }
+
+    button_exti_lines |= pin;
+    return 1;
+}
+#endif
 
 /**
- * @brief Initialize button module
+ * @brief Initialize button module (call after MX_GPIO_Init)
+ * Groups the buttons by GPIO port, one debouncer per port. With
+ * BUTTON_EXTI_WAKE, each button also gets its EXTI line if it is free.
  */
 void button_init(void) {
-    uint8_t i;
+    uint8_t i, p;
+
+    button_port_count = 0;
+#if BUTTON_EXTI_WAKE
+    button_exti_lines = 0;
+    button_polled = 0;
+    button_wake = 0;
+    button_burst = 0;
+#endif
     for (i = 0; i < NUM_BUTTONS; i++) {
-        button_current[i] = BUTTON_RELEASED;
-        button_last[i] = BUTTON_RELEASED;
-        button_stable[i] = BUTTON_RELEASED;
-        button_debounce_counter[i] = 0;
-        button_flag[i] = 0;
-        button_long_press_counter[i] = 0;
-        button_long_press_flag[i] = 0;
+        for (p = 0; p < button_port_count; p++) {
+            if (button_ports[p].port == button_pins[i].port) break;
+        }
+        if (p == button_port_count) {
+            // BUTTON_MAX_PORTS covers every port in button_pins
+            debounce_init(&button_ports[p], button_pins[i].port, 0, 0);
+#if BUTTON_EXTI_WAKE
+            button_poll_mask[p] = 0;
+#endif
+            button_port_count++;
+        }
+#if BUTTON_EXTI_WAKE
+        if (!button_exti_setup(button_pins[i].port, button_pins[i].pin)) {
+            button_poll_mask[p] |= button_pins[i].pin;
+            button_polled = 1;
+        }
+#endif
+        button_ports[p].mask |= button_pins[i].pin;
+        button_ports[p].active_low |= button_pins[i].pin;
+        button_port_index[i] = p;
+
+        button_hold_counter[i] = 0;
+        button_repeat_wait[i] = 0;
+        button_repeat_interval[i] = 0;
+        button_double_armed[i] = 0;
     }
+    button_event_task = SCH_INVALID_HANDLE;
 }
 
 /**
- * @brief Read button state from GPIO
- * @param index: Button index
- * @return GPIO state (inverted for pull-up buttons)
+ * @brief Register the task to signal when a button event is queued
+ * @param handle: Event task handle (SCH_INVALID_HANDLE to disable)
  */
-static uint8_t read_button_gpio(uint8_t index) {
-    GPIO_PinState state;
-    
-    switch(index) {
-        case BUTTON_1_MOD1:
-            state = HAL_GPIO_ReadPin(Button_1_GPIO_Port, Button_1_Pin);
-            break;
-        case BUTTON_2_MOD1:
-            state = HAL_GPIO_ReadPin(Button_2_GPIO_Port, Button_2_Pin);
-            break;
-        case BUTTON_1_MOD2:
-            state = HAL_GPIO_ReadPin(Button_3_GPIO_Port, Button_3_Pin);
-            break;
-        case BUTTON_2_MOD2:
-            state = HAL_GPIO_ReadPin(Button_4_GPIO_Port, Button_4_Pin);
-            break;
-        default:
-            return BUTTON_RELEASED;
-    }
-    
-    // Invert for pull-up buttons (pressed = LOW)
-    return (state == GPIO_PIN_RESET) ? BUTTON_PRESSED : BUTTON_RELEASED;
+void button_set_event_task(uint32_t handle) {
+    button_event_task = handle;
 }
 
+#if BUTTON_EXTI_WAKE
 /**
- * @brief Read and debounce all buttons - called from timer ISR every 10ms
+ * @brief Check whether the inputs are idle, or start a sampling burst
+ * Called before sampling while no burst is running. Buttons with their
+ * own EXTI line cost nothing here; the others are read once per pass.
+ * @return 1 to sample now, 0 to skip this pass
  */
-void button_reading(void) {
-    uint8_t i;
-    
-    for (i = 0; i < NUM_BUTTONS; i++) {
-        // Read current button state
-        button_current[i] = read_button_gpio(i);
-        
-        // Debouncing logic
-        if (button_current[i] == button_last[i]) {
-            button_debounce_counter[i]++;
-            
-            if (button_debounce_counter[i] >= DEBOUNCE_TIME) {
-                // Stable state detected
-                button_debounce_counter[i] = DEBOUNCE_TIME;
-                
-                // Check for state change
-                if (button_current[i] != button_stable[i]) {
-                    button_stable[i] = button_current[i];
-                    
-                    // Rising edge (Pressed) detection
-                    if (button_stable[i] == BUTTON_PRESSED) {
-                        button_flag[i] = 1;
-                        button_long_press_counter[i] = 0;
-                    }
-                }
-                
-                // Long press logic
-                if (button_stable[i] == BUTTON_PRESSED) {
-                    button_long_press_counter[i]++;
-                    if (button_long_press_counter[i] >= 100 && !button_long_press_flag[i]) {
-                        // Long press detected (1 second)
-                        button_long_press_flag[i] = 1;
-                    }
-                } else {
-                    button_long_press_counter[i] = 0;
-                    button_long_press_flag[i] = 0;
-                }
-            }
-        } else {
-            // State changed, reset counter
-            button_debounce_counter[i] = 0;
+static uint8_t button_burst_start(void) {
+    uint8_t p;
+    uint8_t wake;
+
+    __disable_irq();
+    wake = button_wake;
+    button_wake = 0;
+    __enable_irq();
+
+    if (!wake && button_polled) {
+        for (p = 0; p < button_port_count; p++) {
+            const DebouncePort *db = &button_ports[p];
+            if ((db->port->IDR ^ db->active_low) & button_poll_mask[p]) wake = 1;
         }
-        
-        button_last[i] = button_current[i];
     }
+    button_burst = wake;
+    return wake;
+}
+
+/**
+ * @brief End the sampling burst once every button is released and settled
+ * An edge seen while the last samples were taken keeps the burst going.
+ */
+static void button_burst_check(void) {
+    uint8_t p;
+
+    for (p = 0; p < button_port_count; p++) {
+        if (debounce_busy(&button_ports[p])) return;
+    }
+    __disable_irq();
+    if (!button_wake) button_burst = 0;
+    button_wake = 0;
+    __enable_irq();
+}
+
+/**
+ * @brief Button EXTI edge - call from HAL_GPIO_EXTI_Callback
+ * @param pins: EXTI line(s) that fired
+ */
+void button_exti(uint16_t pins) {
+    if (pins & button_exti_lines) button_wake = 1;
+}
+#else
+/**
+ * @brief Button EXTI edge (unused: BUTTON_EXTI_WAKE is 0)
+ * @param pins: EXTI line(s) that fired
+ */
+void button_exti(uint16_t pins) {
+    (void)pins;
+}
+#endif
+
+/**
+ * @brief How often the buttons must be sampled right now
+ * @return BUTTON_SAMPLE_TICK (every tick), BUTTON_SAMPLE_POLL (slowly, only
+ *         buttons without an EXTI line to watch) or BUTTON_SAMPLE_NONE
+ */
+uint8_t button_sampling(void) {
+#if BUTTON_EXTI_WAKE
+    if (button_burst || button_wake) return BUTTON_SAMPLE_TICK;
+    return button_polled ? BUTTON_SAMPLE_POLL : BUTTON_SAMPLE_NONE;
+#else
+    return BUTTON_SAMPLE_TICK;
+#endif
 }
 
 /**
- * @brief Check if button was pressed (one-shot, clears flag after read)
- * @param index: Button index
- * @return 1 if button was pressed, 0 otherwise
+ * @brief Queue a button event and wake the input task
  */
-uint8_t is_button_pressed(uint8_t index) {
-    if (index >= NUM_BUTTONS) return 0;
-    
-    if (button_flag[index] == 1) {
-        button_flag[index] = 0;  // Clear flag
-        return 1;
+static void button_post(uint8_t index, uint8_t type, uint32_t now) {
+    if (input_event_post(index, type, now)) {
+        SCH_Signal(button_event_task);
     }
-    return 0;
 }
 
 /**
- * @brief Check if button is being long pressed
- * @param index: Button index
- * @return 1 if button is long pressed, 0 otherwise
+ * @brief Read and debounce all buttons - called once per timer pass
+ * Each port is read once and debounced in parallel; the per-button work
+ * (events, long-press and repeat counters) only runs while a button
+ * changes or is held. With BUTTON_EXTI_WAKE, sampling only runs in bursts
+ * started by an EXTI edge (or a polled button) and ends when all buttons
+ * are released again.
  */
-uint8_t is_button_long_pressed(uint8_t index) {
-    if (index >= NUM_BUTTONS) return 0;
-    
-    if (button_long_press_flag[index] == 1) {
-        button_long_press_flag[index] = 0;  // Clear flag
-        return 1;
+void button_reading(void) {
+    uint8_t i, p;
+    uint32_t active = 0;
+    uint32_t now;
+
+#if BUTTON_EXTI_WAKE
+    if (!button_burst && !button_burst_start()) return;
+#endif
+
+    for (p = 0; p < button_port_count; p++) {
+        debounce_port(&button_ports[p]);
+        active |= button_ports[p].state | button_ports[p].released;
+    }
+#if BUTTON_EXTI_WAKE
+    button_burst_check();
+#endif
+    if (active == 0) return;
+
+    now = SWT_Get_Tick();
+    for (i = 0; i < NUM_BUTTONS; i++) {
+        const DebouncePort *db = &button_ports[button_port_index[i]];
+        uint16_t pin = button_pins[i].pin;
+
+        if (db->pressed & pin) {
+            button_post(i, INPUT_EVENT_PRESS, now);
+            if (button_double_armed[i] &&
+                now - button_last_press[i] <= BUTTON_DOUBLE_CLICK_TICKS) {
+                button_post(i, INPUT_EVENT_DOUBLE, now);
+                button_double_armed[i] = 0;
+            } else {
+                button_double_armed[i] = 1;
+            }
+            button_last_press[i] = now;
+            button_hold_counter[i] = 0;
+            button_repeat_wait[i] = BUTTON_REPEAT_DELAY_TICKS;
+            button_repeat_interval[i] = BUTTON_REPEAT_START_TICKS;
+        } else if (db->released & pin) {
+            button_post(i, INPUT_EVENT_RELEASE, now);
+        }
+
+        // Long press and accelerating auto-repeat while held
+        if (db->state & pin) {
+            if (button_hold_counter[i] < 0xFFFF) button_hold_counter[i]++;
+            if (button_hold_counter[i] == BUTTON_LONG_PRESS_TICKS) {
+                button_post(i, INPUT_EVENT_LONG, now);
+            }
+            if (--button_repeat_wait[i] == 0) {
+                uint16_t interval = button_repeat_interval[i];
+
+                button_post(i, INPUT_EVENT_REPEAT, now);
+                button_repeat_wait[i] = interval;
+                if (interval > BUTTON_REPEAT_MIN_TICKS) {
+                    interval -= (interval / BUTTON_REPEAT_ACCEL) ? interval / BUTTON_REPEAT_ACCEL : 1;
+                    if (interval < BUTTON_REPEAT_MIN_TICKS) interval = BUTTON_REPEAT_MIN_TICKS;
+                    button_repeat_interval[i] = interval;
+                }
+            }
+        }
     }
-    return 0;
 }
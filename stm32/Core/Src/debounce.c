@@ -0,0 +1,91 @@
+/*
+ * debounce.c
+ * Bit-parallel input debouncer implementation
+ *
+ * An input whose sample differs from its debounced state counts up; a
+ * sample equal to the state clears its counter. When the counter reaches
+ * DEBOUNCE_SAMPLES the state flips and the input shows up in the pressed
+ * or released edge mask. All counters of a word advance together.
+ */
+
+#include "debounce.h"
+
+#if DEBOUNCE_SAMPLES < 1 || DEBOUNCE_SAMPLES > 7
+#error "DEBOUNCE_SAMPLES must be 1..7 (3-bit vertical counters)"
+#endif
+
+// All-ones or all-zeros word matching bit k of DEBOUNCE_SAMPLES
+#define DEBOUNCE_BIT(k)  (((DEBOUNCE_SAMPLES >> (k)) & 1u) ? 0xFFFFFFFFu : 0u)
+
+/**
+ * @brief Initialize a debounced input word
+ * All inputs start inactive.
+ * @param db: Debouncer state (caller-owned)
+ * @param port: GPIO port read by debounce_port(), 0 if fed by debounce_update()
+ * @param mask: Inputs to debounce
+ * @param active_low: Inputs that are active when they read 0 (pull-up buttons)
+ */
+void debounce_init(DebouncePort *db, GPIO_TypeDef *port, uint32_t mask,
+                   uint32_t active_low) {
+    db->port = port;
+    db->mask = mask;
+    db->active_low = active_low & mask;
+    db->state = 0;
+    db->cnt[0] = 0;
+    db->cnt[1] = 0;
+    db->cnt[2] = 0;
+    db->pressed = 0;
+    db->released = 0;
+}
+
+/**
+ * @brief Debounce one sample of all inputs of a word
+ * @param db: Debouncer state
+ * @param raw: Raw input word (pin levels)
+ * @return Mask of inputs whose debounced state changed
+ */
+uint32_t debounce_update(DebouncePort *db, uint32_t raw) {
+    uint32_t sample = (raw ^ db->active_low) & db->mask;
+    uint32_t delta = sample ^ db->state;
+    uint32_t c0 = db->cnt[0];
+    uint32_t c1 = db->cnt[1];
+    uint32_t c2 = db->cnt[2];
+    uint32_t changed;
+
+    // Count up where the sample differs from the state, clear elsewhere
+    c2 = (c2 ^ (c1 & c0)) & delta;
+    c1 = (c1 ^ c0) & delta;
+    c0 = ~c0 & delta;
+
+    // Counters that reached DEBOUNCE_SAMPLES flip their state
+    changed = delta
+            & ~(c0 ^ DEBOUNCE_BIT(0))
+            & ~(c1 ^ DEBOUNCE_BIT(1))
+            & ~(c2 ^ DEBOUNCE_BIT(2));
+
+    db->cnt[0] = c0 & ~changed;
+    db->cnt[1] = c1 & ~changed;
+    db->cnt[2] = c2 & ~changed;
+    db->state ^= changed;
+    db->pressed = changed & db->state;
+    db->released = changed & ~db->state;
+    return changed;
+}
+
+/**
+ * @brief Read the whole port once and debounce its inputs
+ * @param db: Debouncer state initialized with a port
+ * @return Mask of inputs whose debounced state changed
+ */
+uint32_t debounce_port(DebouncePort *db) {
+    return debounce_update(db, db->port->IDR);
+}
+
+/**
+ * @brief Inputs that are active or still counting towards a change
+ * @param db: Debouncer state
+ * @return 0 once every input is inactive and settled
+ */
+uint32_t debounce_busy(const DebouncePort *db) {
+    return db->state | db->cnt[0] | db->cnt[1] | db->cnt[2];
+}
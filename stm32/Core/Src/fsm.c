@@ -7,117 +7,290 @@
 #include "fsm.h"
 #include "global.h"
 #include "button.h"
+#include "input_event.h"
 #include "light.h"
 #include "i2c-lcd.h"
 #include "timer.h"
-#include <stdio.h>
-#include <string.h>
+#include "sched.h"
+#include "task_manifest.h"
+#include "lcd_text.h"
 
 // Local variables
 static uint8_t lcd_update_flag = 0;
 
+// Bit i set while display i shows big digits (its glyphs are loaded)
+static uint8_t fsm_lcd_big_ready = 0;
+
+// Displays on I2C1, one per approach (PCF8574 7-bit addresses)
+static const uint8_t fsm_lcd_addresses[] = { 0x21 };
+#define FSM_LCD_COUNT  (sizeof(fsm_lcd_addresses) / sizeof(fsm_lcd_addresses[0]))
+static LcdHandle fsm_lcds[FSM_LCD_COUNT];
+
+// LCD line templates, LCD_COLS characters each
+static const char lcd_tpl_splash[LCD_COLS + 1]        = "  HCMUT PROJECT ";
+static const char lcd_tpl_title[LCD_COLS + 1]         = "TRAFFIC LIGHT   ";
+static const char lcd_tpl_countdown[LCD_COLS + 1]     = "R:--  Y:--  G:--";
+static const char lcd_tpl_unbalanced[LCD_COLS + 1]    = " ERR: UNBALANCED";
+static const char lcd_tpl_config_red[LCD_COLS + 1]    = "  CONFIG RED    ";
+static const char lcd_tpl_config_yellow[LCD_COLS + 1] = "  CONFIG YELLOW ";
+static const char lcd_tpl_config_green[LCD_COLS + 1]  = "  CONFIG GREEN  ";
+static const char lcd_tpl_manual[LCD_COLS + 1]        = "  OPR: MANUAL   ";
+static const char lcd_tpl_ns_red[LCD_COLS + 1]        = "NS:R  EW:G      ";
+static const char lcd_tpl_ns_green[LCD_COLS + 1]      = "NS:G  EW:R      ";
+static const char lcd_tpl_flash_yellow[LCD_COLS + 1]  = "FLASH YEL       ";
+static const char lcd_tpl_flash_red[LCD_COLS + 1]     = "FLASH RED       ";
+
+// Digit slots of lcd_tpl_countdown
+#define LCD_SLOT_RED     2
+#define LCD_SLOT_YELLOW  8
+#define LCD_SLOT_GREEN   14
+
+// Slot of the countdown in each phase (indexed by TrafficPhase)
+static const uint8_t lcd_slot_ns[] = { LCD_SLOT_GREEN, LCD_SLOT_YELLOW, LCD_SLOT_RED, LCD_SLOT_RED };
+static const uint8_t lcd_slot_ew[] = { LCD_SLOT_RED, LCD_SLOT_RED, LCD_SLOT_GREEN, LCD_SLOT_YELLOW };
+
+#if FSM_LCD_BIG_DIGITS
+// Big-digit countdown: direction letter above its color, then two digits
+static const char lcd_tpl_big_top[LCD_COLS + 1]       = "N       E       ";
+static const char lcd_tpl_blank[LCD_COLS + 1]         = "                ";
+#define LCD_BIG_NS       1
+#define LCD_BIG_EW       9
+
+// Light color of each direction in each phase (indexed by TrafficPhase)
+static const char lcd_color_ns[] = { 'G', 'Y', 'R', 'R' };
+static const char lcd_color_ew[] = { 'R', 'R', 'G', 'Y' };
+#endif
+
+/**
+ * @brief Check if durations are balanced (R == Y + G)
+ */
+static uint8_t check_balance(void) {
+    return (redDuration == (yellowDuration + greenDuration));
+}
+
+/**
+ * @brief Enter AUTO NORM mode and drive the lights for its first phase
+ */
+static void fsm_start_auto(void) {
+    currentState = STATE_AUTO_NORM;
+    isBalanced = check_balance();
+    if (isBalanced) {
+        currentPhase = PHASE_NS_GREEN_EW_RED;
+        nsCountdown = greenDuration;
+        ewCountdown = redDuration;
+        light_set_ns(LIGHT_GREEN);
+        light_set_ew(LIGHT_RED);
+    } else {
+        light_off_all();
+    }
+}
+
 /**
  * @brief Initialize FSM
+ * The lights start in AUTO NORM right away; the LCD shows the INIT splash
+ * for the first 3 seconds while it is being initialised.
  */
 void fsm_init(void) {
-    currentState = STATE_INIT;
+    uint8_t i;
+
+    for (i = 0; i < FSM_LCD_COUNT; i++) {
+        lcd_attach(&fsm_lcds[i], LCD_ADDRESS(fsm_lcd_addresses[i]));
+    }
+#if FSM_LCD_BIG_DIGITS
+    lcd_set_glyphs(lcd_text_big_glyphs, LCD_BIG_GLYPHS);
+#endif
+    fsm_lcd_big_ready = 0;
+    initDisplayCounter = 0;
+    fsm_start_auto();
     lcd_update_flag = 1;
 }
 
 /**
- * @brief Check if durations are balanced (R == Y + G)
+ * @brief Run the LCD bus without blocking (scheduler task)
+ * Initialisation, presence checks and the refresh of changed cells of
+ * every display; reschedules itself for the delay the driver asks for.
+ * A display is redrawn by the driver whenever it becomes ready, and by
+ * the FSM when its glyphs come or go (big digits or the fallback).
  */
-static uint8_t check_balance(void) {
-    return (redDuration == (yellowDuration + greenDuration));
+void fsm_lcd_service(void) {
+    uint32_t wait_ms = lcd_service();
+#if FSM_LCD_BIG_DIGITS
+    uint8_t ready = 0;
+    uint8_t i;
+
+    for (i = 0; i < FSM_LCD_COUNT; i++) {
+        if (lcd_glyphs_ready(&fsm_lcds[i])) ready |= (uint8_t)(1u << i);
+    }
+    if (ready != fsm_lcd_big_ready) {
+        fsm_lcd_big_ready = ready;
+        lcd_update_flag = 1;
+    }
+#endif
+
+    SCH_Reschedule_Task(TASK_HANDLE(LCD_SERVICE), (wait_ms + 9) / 10);
 }
 
+/**
+ * @brief Write the three durations into a countdown line
+ */
+static void fsm_lcd_put_durations(char *line) {
+    lcd_text_load(line, lcd_tpl_countdown);
+    lcd_text_put2(&line[LCD_SLOT_RED], redDuration);
+    lcd_text_put2(&line[LCD_SLOT_YELLOW], yellowDuration);
+    lcd_text_put2(&line[LCD_SLOT_GREEN], greenDuration);
+}
+
+#if FSM_LCD_BIG_DIGITS
+/**
+ * @brief Show both countdowns in big digits, each after its light color
+ * @param hlcd: Display whose glyphs are loaded
+ */
+static void fsm_lcd_display_big(LcdHandle *hlcd) {
+    LcdLine line1;
+    LcdLine line2;
+
+    lcd_text_load(line1, lcd_tpl_big_top);
+    lcd_text_load(line2, lcd_tpl_blank);
+    line2[LCD_BIG_NS - 1] = lcd_color_ns[currentPhase];
+    line2[LCD_BIG_EW - 1] = lcd_color_ew[currentPhase];
+    lcd_text_put_big2(&line1[LCD_BIG_NS], &line2[LCD_BIG_NS], nsCountdown);
+    lcd_text_put_big2(&line1[LCD_BIG_EW], &line2[LCD_BIG_EW], ewCountdown);
+    lcd_display_2lines(hlcd, line1, line2);
+}
+#endif
+
 /**
  * @brief Update LCD display based on current state
+ * Lines are constant templates; only numbers are patched into a copy.
  */
 void fsm_lcd_update(void) {
+    uint8_t i;
+#if FSM_LCD_BIG_DIGITS
+    uint8_t big = 0;
+#endif
+
     if (!lcd_update_flag) return;
     lcd_update_flag = 0;
     
-    char line1[20] = {0};
-    char line2[20] = {0};
+    LcdLine line1;
+    LcdLine line2;
+    const char *text1 = line1;
+    const char *text2 = line2;
     
-    switch(currentState) {
+    // INIT splash during the first seconds, whatever the lights are doing
+    switch(initDisplayCounter <= 3 ? STATE_INIT : currentState) {
         case STATE_INIT:
-            sprintf(line1, "  HCMUT PROJECT  ");
-            sprintf(line2, "TRAFFIC LIGHT  ");
+            text1 = lcd_tpl_splash;
+            text2 = lcd_tpl_title;
             break;
             
         case STATE_AUTO_NORM:
             if (isBalanced) {
-                // Display countdown for both directions based on current phase
-                switch(currentPhase) {
-                    case PHASE_NS_GREEN_EW_RED:
-                        sprintf(line1, "  R:--  Y:--  G:%02d", nsCountdown);
-                        sprintf(line2, "R:%02d  Y:--  G:--", ewCountdown);
-                        break;
-                    case PHASE_NS_YELLOW_EW_RED:
-                        sprintf(line1, "  R:--  Y:%02d  G:--", nsCountdown);
-                        sprintf(line2, "R:%02d  Y:--  G:--", ewCountdown);
-                        break;
-                    case PHASE_NS_RED_EW_GREEN:
-                        sprintf(line1, "  R:%02d  Y:--  G:--", nsCountdown);
-                        sprintf(line2, "R:--  Y:--  G:%02d", ewCountdown);
-                        break;
-                    case PHASE_NS_RED_EW_YELLOW:
-                        sprintf(line1, "  R:%02d  Y:--  G:--", nsCountdown);
-                        sprintf(line2, "R:--  Y:%02d  G:--", ewCountdown);
-                        break;
-                }
+                // Countdown of each direction in the slot of its current
+                // color, for displays that cannot show big digits (yet)
+                lcd_text_load(line1, lcd_tpl_countdown);
+                lcd_text_load(line2, lcd_tpl_countdown);
+                lcd_text_put2(&line1[lcd_slot_ns[currentPhase]], nsCountdown);
+                lcd_text_put2(&line2[lcd_slot_ew[currentPhase]], ewCountdown);
+#if FSM_LCD_BIG_DIGITS
+                big = 1;
+#endif
             } else {
-                sprintf(line1, "  ERR: UNBALANCED");
-                sprintf(line2, "R:%02d  Y:%02d  G:%02d", redDuration, yellowDuration, greenDuration);
+                text1 = lcd_tpl_unbalanced;
+                fsm_lcd_put_durations(line2);
             }
             break;
             
         case STATE_AUTO_RED:
-            sprintf(line1, "  CONFIG RED     ");
-            sprintf(line2, "R:%02d  Y:%02d  G:%02d", redDuration, yellowDuration, greenDuration);
+            text1 = lcd_tpl_config_red;
+            fsm_lcd_put_durations(line2);
             break;
             
         case STATE_AUTO_YEL:
-            sprintf(line1, "  CONFIG YELLOW  ");
-            sprintf(line2, "R:%02d  Y:%02d  G:%02d", redDuration, yellowDuration, greenDuration);
+            text1 = lcd_tpl_config_yellow;
+            fsm_lcd_put_durations(line2);
             break;
             
         case STATE_AUTO_GRN:
-            sprintf(line1, "  CONFIG GREEN   ");
-            sprintf(line2, "R:%02d  Y:%02d  G:%02d", redDuration, yellowDuration, greenDuration);
+            text1 = lcd_tpl_config_green;
+            fsm_lcd_put_durations(line2);
             break;
             
         case STATE_MANUAL:
-            sprintf(line1, "  OPR: MANUAL    ");
+            text1 = lcd_tpl_manual;
             if (manualSubState == MANUAL_NS_RED_EW_GREEN) {
-                sprintf(line2, "NS:R  EW:G     ");
+                text2 = lcd_tpl_ns_red;
             } else {
-                sprintf(line2, "NS:G  EW:R     ");
+                text2 = lcd_tpl_ns_green;
             }
             break;
             
         case STATE_MANUAL_FLASH_YEL:
-            sprintf(line1, "  OPR: MANUAL    ");
-            sprintf(line2, "FLASH YEL      ");
+            text1 = lcd_tpl_manual;
+            text2 = lcd_tpl_flash_yellow;
             break;
             
         case STATE_MANUAL_FLASH_RED:
-            sprintf(line1, "  OPR: MANUAL    ");
-            sprintf(line2, "FLASH RED      ");
+            text1 = lcd_tpl_manual;
+            text2 = lcd_tpl_flash_red;
             break;
+
+        default:
+            return;
     }
     
-    lcd_display_2lines(line1, line2);
+    // Same screen on every display; sent by the LCD service task
+    for (i = 0; i < FSM_LCD_COUNT; i++) {
+#if FSM_LCD_BIG_DIGITS
+        if (big && (fsm_lcd_big_ready & (1u << i))) {
+            fsm_lcd_display_big(&fsm_lcds[i]);
+            continue;
+        }
+#endif
+        lcd_display_2lines(&fsm_lcds[i], text1, text2);
+    }
+    SCH_Reschedule_Task(TASK_HANDLE(LCD_SERVICE), 0);
 }
 
 /**
- * @brief Scan buttons and handle state transitions
+ * @brief Change the duration being configured (AUTO RED/YEL/GRN)
+ * @param step: +1 or -1 seconds
+ * @param wrap: 1 to wrap around 1..99 (single press), 0 to stop at the
+ *              ends (auto-repeat while held)
+ * @return 1 if a duration is being configured, 0 in other states
  */
-void fsm_button_scan(void) {
+static uint8_t fsm_step_duration(int8_t step, uint8_t wrap) {
+    uint8_t *duration;
+
+    switch (currentState) {
+        case STATE_AUTO_RED: duration = &redDuration; break;
+        case STATE_AUTO_YEL: duration = &yellowDuration; break;
+        case STATE_AUTO_GRN: duration = &greenDuration; break;
+        default: return 0;
+    }
+
+    if (step > 0 && *duration >= 99) {
+        if (!wrap) return 1;
+        *duration = 1;
+    } else if (step < 0 && *duration <= 1) {
+        if (!wrap) return 1;
+        *duration = 99;
+    } else {
+        *duration += step;
+    }
+    // Redrawn by the next fsm_lcd_update(), so a burst of steps while a
+    // button is held costs one LCD update per 100ms
+    lcd_update_flag = 1;
+    return 1;
+}
+
+/**
+ * @brief Handle a button press
+ * @param button: Button index (BUTTON_*)
+ */
+static void fsm_button_press(uint8_t button) {
     // BUTTON_1_MOD1: Switch between AUTO and MANUAL modes
-    if (is_button_pressed(BUTTON_1_MOD1)) {
+    if (button == BUTTON_1_MOD1) {
         if (currentState == STATE_MANUAL || 
             currentState == STATE_MANUAL_FLASH_YEL || 
             currentState == STATE_MANUAL_FLASH_RED) {
@@ -150,7 +323,7 @@ void fsm_button_scan(void) {
     }
     
     // BUTTON_2_MOD1: Different behavior based on mode
-    if (is_button_pressed(BUTTON_2_MOD1)) {
+    if (button == BUTTON_2_MOD1) {
         if (currentState >= STATE_AUTO_NORM && currentState <= STATE_AUTO_GRN) {
             // AUTO mode: cycle through config modes
             switch(currentState) {
@@ -197,22 +370,9 @@ void fsm_button_scan(void) {
     }
     
     // BUTTON_1_MOD2: Different behavior based on mode
-    if (is_button_pressed(BUTTON_1_MOD2)) {
-        if (currentState == STATE_AUTO_RED) {
-            // Increase RED duration
-            redDuration++;
-            if (redDuration > 99) redDuration = 1;
-            lcd_update_flag = 1;
-        } else if (currentState == STATE_AUTO_YEL) {
-            // Increase YELLOW duration
-            yellowDuration++;
-            if (yellowDuration > 99) yellowDuration = 1;
-            lcd_update_flag = 1;
-        } else if (currentState == STATE_AUTO_GRN) {
-            // Increase GREEN duration
-            greenDuration++;
-            if (greenDuration > 99) greenDuration = 1;
-            lcd_update_flag = 1;
+    if (button == BUTTON_1_MOD2) {
+        if (fsm_step_duration(1, 1)) {
+            // Increased the duration being configured
         } else if (currentState == STATE_MANUAL) {
             // Flash YELLOW
             currentState = STATE_MANUAL_FLASH_YEL;
@@ -229,22 +389,9 @@ void fsm_button_scan(void) {
     }
     
     // BUTTON_2_MOD2: Different behavior based on mode
-    if (is_button_pressed(BUTTON_2_MOD2)) {
-        if (currentState == STATE_AUTO_RED) {
-            // Decrease RED duration
-            redDuration--;
-            if (redDuration < 1) redDuration = 99;
-            lcd_update_flag = 1;
-        } else if (currentState == STATE_AUTO_YEL) {
-            // Decrease YELLOW duration
-            yellowDuration--;
-            if (yellowDuration < 1) yellowDuration = 99;
-            lcd_update_flag = 1;
-        } else if (currentState == STATE_AUTO_GRN) {
-            // Decrease GREEN duration
-            greenDuration--;
-            if (greenDuration < 1) greenDuration = 99;
-            lcd_update_flag = 1;
+    if (button == BUTTON_2_MOD2) {
+        if (fsm_step_duration(-1, 1)) {
+            // Decreased the duration being configured
         } else if (currentState == STATE_MANUAL) {
             // Flash RED
             currentState = STATE_MANUAL_FLASH_RED;
@@ -261,6 +408,25 @@ void fsm_button_scan(void) {
     }
 }
 
+/**
+ * @brief Handle the queued input events (event task)
+ * Every press is handled in order, also several presses queued between
+ * two runs of the task.
+ */
+void fsm_button_scan(void) {
+    InputEvent event;
+
+    while (input_event_get(&event)) {
+        if (event.type == INPUT_EVENT_PRESS) {
+            fsm_button_press(event.input);
+        } else if (event.type == INPUT_EVENT_REPEAT) {
+            // Hold to scroll the duration being configured
+            if (event.input == BUTTON_1_MOD2) fsm_step_duration(1, 0);
+            if (event.input == BUTTON_2_MOD2) fsm_step_duration(-1, 0);
+        }
+    }
+}
+
 /**
  * @brief Update countdown timers (called every 1 second)
  */
@@ -344,24 +510,11 @@ void fsm_flash_update(void) {
  * @brief Main FSM run function (called from scheduler)
  */
 void fsm_run(void) {
-    // Handle INIT state
-    if (currentState == STATE_INIT) {
-        if (initDisplayCounter >= 3) {
-            // After 3 seconds, switch to AUTO NORM mode
-            currentState = STATE_AUTO_NORM;
-            isBalanced = check_balance();
-            if (isBalanced) {
-                currentPhase = PHASE_NS_GREEN_EW_RED;
-                nsCountdown = greenDuration;
-                ewCountdown = redDuration;
-                light_set_ns(LIGHT_GREEN);
-                light_set_ew(LIGHT_RED);
-            } else {
-                light_off_all();
-            }
+    // End of the INIT splash after 3 seconds
+    if (initDisplayCounter <= 3) {
+        if (initDisplayCounter == 3) {
             lcd_update_flag = 1;
-        } else {
-            initDisplayCounter++;
         }
+        initDisplayCounter++;
     }
 }
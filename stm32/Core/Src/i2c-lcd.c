@@ -2,13 +2,222 @@
 Edit by modify: Ngoc Hang 
 **/
 
+/* Several displays (PCF8574 backpacks at different addresses) share I2C1.
+ * Each one is an LcdHandle holding the text to show, a copy of what is on
+ * its screen and a map of the cells that differ. lcd_display_2lines() only
+ * updates that map; lcd_service(), run from a scheduler task, sends the
+ * dirty cells, visiting the displays round-robin within a bus-time budget
+ * per 10ms window, so more displays do not mean longer bursts of I2C
+ * interrupts.
+ *
+ * Commands and characters become 4-byte PCF8574 frames (two nibbles, each
+ * with EN high then low) in a RAM queue, drained with interrupt-driven
+ * I2C transfers, each completion starting the next one, so callers never
+ * wait for the bus. The queue only ever holds frames for one display; a
+ * transfer carries everything queued so far (up to the end of the
+ * buffer), so a refresh pays for one start/address instead of one per
+ * character.
+ *
+ * A display that does not answer at boot, or whose transfers keep
+ * failing, goes headless: its traffic is dropped without touching the
+ * bus, and lcd_service() only re-probes its address now and then until it
+ * comes back, when it is initialised again and redrawn.
+ *
+ * A slave holding SDA low leaves the I2C peripheral stuck BUSY. This is
+ * detected from bus/arbitration errors and from a BUSY flag with no
+ * transfer of ours on the bus; the pins are then driven as GPIO to clock
+ * the slave free and send a STOP, one edge per lcd_service() call, the
+ * peripheral is reset and the queued frames are sent again. */
+
 #include "i2c-lcd.h"
 #include "main.h"
+#include "prof.h"
+#include <string.h>
 extern I2C_HandleTypeDef hi2c1;  // change your handler here accordingly
 
-#define SLAVE_ADDRESS_LCD (0x21 << 1) // change this according to ur setup
+/* I2C1 pins (remapped, see HAL_I2C_MspInit), driven directly for bus recovery */
+#define LCD_I2C_PORT GPIOB
+#define LCD_SCL_PIN GPIO_PIN_8
+#define LCD_SDA_PIN GPIO_PIN_9
+
+/* One dirty bit per column */
+#define LCD_ROW_ALL ((uint16_t)((1u << LCD_COLS) - 1u))
+_Static_assert(LCD_COLS <= 16, "dirty map holds 16 columns per row");
+
+/* Registered displays, and where the next refresh starts looking */
+static LcdHandle *lcd_list = 0;
+static LcdHandle *lcd_refresh_next = 0;
+
+/* Frame queue: head is advanced by the main loop, tail by the I2C
+ * interrupt. Both run freely; their difference is the queued byte count */
+#define LCD_FRAME_SIZE 4
+/* Largest batch that has to go out whole: one glyph (CGRAM address,
+ * 8 rows, back to DDRAM). The refresh budget never drops below it. */
+#define LCD_BATCH_MAX (10 * LCD_FRAME_SIZE)
+#define LCD_IDLE_BYTE 0x08 // EN low, backlight on: no strobe, used as bus-time padding
+static uint8_t lcd_queue[LCD_QUEUE_SIZE];
+static volatile uint16_t lcd_queue_head = 0;
+static volatile uint16_t lcd_queue_tail = 0;
+static volatile uint8_t lcd_tx_busy = 0;
+static volatile uint16_t lcd_tx_len = 0;
+static LcdHandle *volatile lcd_tx_owner = 0; // display the queued frames are for
+static uint8_t lcd_batch = 0; // frames are being collected, do not start the bus yet
+static volatile uint8_t lcd_queue_drop = 0; // owner went headless: lcd_service() empties the queue
+
+/* Refresh budget: bytes that may still be queued in the current window */
+#define LCD_BUS_WINDOW_MS 10
+static uint32_t lcd_budget_window = 0;
+static uint16_t lcd_budget_left = 0;
+
+/* Bus statistics */
+static LcdBusStats lcd_stats;
+
+/* Probe ladder for the bus clock, fastest first (Hz) */
+static const uint32_t lcd_bus_speeds[] = { 400000, 100000, 50000 };
+static uint32_t lcd_bus_speed = 0; // speed chosen by the probe, 0 if no answer
+static uint8_t lcd_bus_probed = 0; // the boot probe has run (later ones follow a late display)
+
+/* Speed probe progress (see lcd_probe_step) */
+#define LCD_PROBE_ROUNDS 4 // idle bursts a backpack must take at a speed
+static uint8_t lcd_probe_active = 0;
+static uint8_t lcd_probe_index = 0; // speed being tried
+static LcdHandle *lcd_probe_next = 0; // display checked by the next step, 0: all done
+static uint8_t lcd_probe_round = 0; // 0: address check, then idle bursts
+static uint8_t lcd_probe_answered = 0;
+static uint8_t lcd_probe_healthy = 1;
+
+/* Bus state: power-on wait and speed probe, normal operation, recovery */
+#define LCD_POWER_ON_MS 50
+#define LCD_BUS_PROBE 0
+#define LCD_BUS_RUN 1
+#define LCD_BUS_RECOVER 2
+static uint8_t lcd_bus_state = LCD_BUS_PROBE;
+
+/* Display states (LcdHandle.state); the I2C interrupt may switch a working
+ * display to headless */
+#define LCD_STATE_POWER_ON 0
+#define LCD_STATE_FUNCTION_SET 1
+#define LCD_STATE_GLYPHS 2
+#define LCD_STATE_READY 3
+#define LCD_STATE_HEADLESS 4
+
+/* Custom characters, loaded into CGRAM after every initialisation */
+static const uint8_t (*lcd_glyphs)[8] = 0;
+static uint8_t lcd_glyph_count = 0;
+
+/* Bus recovery progress (see lcd_recover_step) */
+#define LCD_RECOVER_PULSES 9
+#define LCD_RECOVER_TRIES 3
+static volatile uint8_t lcd_recover_request = 0; // set on BERR/ARLO or a BUSY timeout
+static uint8_t lcd_recover_edge = 0;
+static uint8_t lcd_recover_resume = 0; // bus state to return to
+static uint8_t lcd_recover_tries = 0;
+static uint8_t lcd_stuck_seen = 0; // BUSY without a transfer at the last check
+#if PROF_ENABLE
+static uint32_t lcd_tx_start;
+#endif
+
+/* Start the next transfer if the bus is idle (main loop or I2C interrupt).
+ * Only the claim of the bus is done with interrupts masked, and a bus
+ * still BUSY (the STOP of the last transfer, or another master) defers
+ * the frames to lcd_service(), so the HAL never waits for it. */
+static void lcd_start_tx (void)
+{
+	uint32_t primask = __get_PRIMASK();
+	LcdHandle *owner;
+	uint16_t tail;
+	uint16_t len = 0;
+
+	__disable_irq();
+	tail = lcd_queue_tail;
+	owner = lcd_tx_owner;
+	if (!lcd_tx_busy && lcd_queue_head != tail && !lcd_recover_request &&
+	    lcd_bus_state == LCD_BUS_RUN && owner && owner->state != LCD_STATE_HEADLESS &&
+	    __HAL_I2C_GET_FLAG(&hi2c1, I2C_FLAG_BUSY) == RESET)
+	{
+		// Everything queued, up to the end of the buffer, in one transfer
+		uint16_t room = LCD_QUEUE_SIZE - tail % LCD_QUEUE_SIZE;
+		len = lcd_queue_head - tail;
+		if (len > room) len = room;
+
+		lcd_tx_busy = 1;
+		lcd_tx_len = len;
+	}
+	__set_PRIMASK(primask);
+	if (len == 0) return;
+
+#if PROF_ENABLE
+	lcd_tx_start = PROF_CYCLES();
+#endif
+	if (HAL_I2C_Master_Transmit_IT(&hi2c1, owner->address,
+			&lcd_queue[tail % LCD_QUEUE_SIZE], len) != HAL_OK)
+	{
+		lcd_tx_busy = 0; // retried by the next lcd_service() call
+		if (hi2c1.ErrorCode & HAL_I2C_ERROR_TIMEOUT) lcd_recover_request = 1;
+	}
+}
+
+/* Take the queue for a display: possible when it is empty or already
+ * holds frames for that display. Returns 1 if frames may be queued. */
+static uint8_t lcd_claim (LcdHandle *hlcd)
+{
+	if (lcd_bus_state != LCD_BUS_RUN || hlcd->state == LCD_STATE_HEADLESS) return 0;
+	if (lcd_queue_head != lcd_queue_tail || lcd_tx_busy) return lcd_tx_owner == hlcd;
+	lcd_tx_owner = hlcd;
+	return 1;
+}
+
+/* Bytes that can be queued now: free queue space, and refresh budget
+ * left in the current window */
+static uint16_t lcd_room (void)
+{
+	uint16_t room = LCD_QUEUE_SIZE - (uint16_t)(lcd_queue_head - lcd_queue_tail);
+
+	return room < lcd_budget_left ? room : lcd_budget_left;
+}
+
+/* Append bytes for the owner of the queue; dropped (and the display
+ * marked for a full redraw) if the queue is full */
+static void lcd_queue_bytes (const uint8_t *bytes, uint16_t len)
+{
+	uint16_t head = lcd_queue_head;
+	uint16_t i;
+
+	if (lcd_tx_owner->state == LCD_STATE_HEADLESS) return;
+	if ((uint16_t)(head - lcd_queue_tail) > LCD_QUEUE_SIZE - len)
+	{
+		lcd_tx_owner->lost = 1;
+		return;
+	}
+	for (i = 0; i < len; i++)
+	{
+		lcd_queue[(uint16_t)(head + i) % LCD_QUEUE_SIZE] = bytes ? bytes[i] : LCD_IDLE_BYTE;
+	}
+	lcd_queue_head = head + len;
+	lcd_budget_left = lcd_budget_left > len ? lcd_budget_left - len : 0;
+	if (!lcd_batch) lcd_start_tx();
+}
+
+/* Make the controller wait: idle bytes keep the bus busy for at least
+ * the given time at the current clock (9 bit times per byte) before the
+ * next queued strobe. Used for execution times of slow commands. */
+static void lcd_queue_wait_us (uint32_t us)
+{
+	uint32_t speed = hi2c1.Init.ClockSpeed;
 
-void lcd_send_cmd (char cmd)
+	lcd_queue_bytes(0, (uint16_t)((us * (speed / 1000u) + 8999u) / 9000u));
+}
+
+/* Send a single nibble (8-bit mode function set during initialisation) */
+static void lcd_queue_nibble (uint8_t nibble)
+{
+	uint8_t data_t[2];
+	data_t[0] = (nibble & 0xf0)|0x0C;  //en=1, rs=0
+	data_t[1] = (nibble & 0xf0)|0x08;  //en=0, rs=0
+	lcd_queue_bytes(data_t, 2);
+}
+
+static void lcd_queue_cmd (char cmd)
 {
   char data_u, data_l;
 	uint8_t data_t[4];
@@ -18,10 +227,10 @@ void lcd_send_cmd (char cmd)
 	data_t[1] = data_u|0x08;  //en=0, rs=0
 	data_t[2] = data_l|0x0C;  //en=1, rs=0
 	data_t[3] = data_l|0x08;  //en=0, rs=0
-	HAL_I2C_Master_Transmit (&hi2c1, SLAVE_ADDRESS_LCD,(uint8_t *) data_t, 4, 100);
+	lcd_queue_bytes(data_t, LCD_FRAME_SIZE);
 }
 
-void lcd_send_data (char data)
+static void lcd_queue_data (char data)
 {
 	char data_u, data_l;
 	uint8_t data_t[4];
@@ -31,57 +240,692 @@ void lcd_send_data (char data)
 	data_t[1] = data_u|0x09;  //en=0, rs=0
 	data_t[2] = data_l|0x0D;  //en=1, rs=0
 	data_t[3] = data_l|0x09;  //en=0, rs=0
-	HAL_I2C_Master_Transmit (&hi2c1, SLAVE_ADDRESS_LCD,(uint8_t *) data_t, 4, 100);
+	lcd_queue_bytes(data_t, LCD_FRAME_SIZE);
+}
+
+/* DDRAM address of a cell (row 0 or 1) */
+static void lcd_queue_goto (uint8_t row, uint8_t col)
+{
+	lcd_queue_cmd((char)(0x80 | (row ? 0x40 : 0x00) | col));
+}
+
+/* Drop the bytes of the transfer that just ended and start the next one */
+static void lcd_tx_next (void)
+{
+	lcd_queue_tail += lcd_tx_len;
+	lcd_tx_busy = 0;
+	lcd_start_tx();
+}
+
+/* I2C transfer finished (called from HAL_I2C_MasterTxCpltCallback) */
+void lcd_tx_complete (void)
+{
+	lcd_stats.transfers++;
+	lcd_stats.bytes += lcd_tx_len;
+#if PROF_ENABLE
+	lcd_stats.busy_cycles += PROF_CYCLES() - lcd_tx_start;
+#endif
+	lcd_tx_owner->error_run = 0;
+	lcd_tx_next();
+}
+
+/* I2C transfer failed (called from HAL_I2C_ErrorCallback): the frame is
+ * skipped and the display is redrawn. After LCD_ERROR_LIMIT failures in a
+ * row the display is taken as gone: it goes headless and lcd_service()
+ * drops its frames (the queue head belongs to the main loop). */
+void lcd_tx_error (void)
+{
+	LcdHandle *owner = lcd_tx_owner;
+
+	lcd_stats.errors++;
+	owner->lost = 1;
+	if (hi2c1.ErrorCode & (HAL_I2C_ERROR_BERR | HAL_I2C_ERROR_ARLO))
+	{
+		// Bus fault, not a missing display: keep the frames for after recovery
+		lcd_recover_request = 1;
+		lcd_tx_busy = 0;
+		return;
+	}
+	if (++owner->error_run >= LCD_ERROR_LIMIT)
+	{
+		owner->error_run = 0;
+		owner->state = LCD_STATE_HEADLESS;
+		owner->due = HAL_GetTick() + LCD_REPROBE_MS;
+		lcd_stats.headless++;
+		lcd_queue_drop = 1;
+		lcd_tx_busy = 0;
+		return;
+	}
+	lcd_tx_next();
+}
+
+void lcd_get_bus_stats (LcdBusStats *stats)
+{
+	__disable_irq();
+	*stats = lcd_stats;
+	__enable_irq();
+}
+
+uint8_t lcd_busy (void)
+{
+	return lcd_queue_head != lcd_queue_tail;
+}
+
+/* Reconfigure I2C1 for another clock speed (bus idle) */
+static void lcd_set_bus_speed (uint32_t speed)
+{
+	hi2c1.Init.ClockSpeed = speed;
+	hi2c1.Init.DutyCycle = I2C_DUTYCYCLE_2;
+	HAL_I2C_Init(&hi2c1);
+}
+
+/* Try the bus speed lcd_bus_speeds[index]: every display is checked again */
+static void lcd_probe_try (uint8_t index)
+{
+	lcd_probe_index = index;
+	lcd_probe_next = lcd_list;
+	lcd_probe_round = 0;
+	lcd_probe_answered = 0;
+	lcd_probe_healthy = 1;
+	lcd_set_bus_speed(lcd_bus_speeds[index]);
+}
+
+/* Set the displays up once the speed is chosen: those that answered are
+ * initialised, the others go headless. With no speed (no display answered)
+ * the bus is left at the slowest one, and the probe runs again when a
+ * display first answers its re-probe. */
+static void lcd_probe_finish (void)
+{
+	LcdHandle *hlcd;
+
+	for (hlcd = lcd_list; hlcd; hlcd = hlcd->next)
+	{
+		if (lcd_bus_speed == 0) hlcd->state = LCD_STATE_HEADLESS;
+		if (hlcd->state == LCD_STATE_HEADLESS)
+		{
+			hlcd->due = HAL_GetTick() + LCD_REPROBE_MS;
+			if (!lcd_bus_probed) lcd_stats.headless++; // later: headless already
+		}
+		else
+		{
+			hlcd->due = HAL_GetTick();
+		}
+	}
+	lcd_bus_probed = 1;
+}
+
+/* One step of the speed probe: pick the fastest speed, up to
+ * LCD_I2C_SPEED_MAX, at which every answering backpack works reliably.
+ * A step is one address check, or one burst of idle bytes (EN low,
+ * backlight on) that must go out without any bus error, so the LCD task
+ * blocks for at most one short blocking transfer per call.
+ * Returns 1 once the probe is over (lcd_bus_speed is set, 0 if no display
+ * answered), 0 while it still runs. */
+static uint8_t lcd_probe_step (void)
+{
+	LcdHandle *hlcd = lcd_probe_next;
+	uint8_t idle[8];
+	uint8_t i;
+
+	if (!lcd_probe_active)
+	{
+		for (i = 0; lcd_bus_speeds[i] > LCD_I2C_SPEED_MAX &&
+		            i + 1u < sizeof(lcd_bus_speeds) / sizeof(lcd_bus_speeds[0]); i++) {}
+		lcd_bus_speed = 0;
+		lcd_probe_active = 1;
+		lcd_probe_try(i);
+		return 0;
+	}
+
+	if (hlcd)
+	{
+		if (lcd_probe_round == 0)
+		{
+			hlcd->state = LCD_STATE_HEADLESS;
+			if (HAL_I2C_IsDeviceReady(&hi2c1, hlcd->address, 3, 2) == HAL_OK)
+			{
+				hlcd->state = LCD_STATE_POWER_ON;
+				lcd_probe_answered++;
+				lcd_probe_round = 1;
+				return 0;
+			}
+		}
+		else
+		{
+			memset(idle, 0x08, sizeof(idle));
+			if (HAL_I2C_Master_Transmit(&hi2c1, hlcd->address, idle, sizeof(idle), 2) != HAL_OK ||
+			    hi2c1.ErrorCode != HAL_I2C_ERROR_NONE)
+			{
+				lcd_probe_healthy = 0;
+			}
+			else if (++lcd_probe_round <= LCD_PROBE_ROUNDS)
+			{
+				return 0;
+			}
+		}
+		// This display is done at this speed
+		lcd_probe_round = 0;
+		lcd_probe_next = hlcd->next;
+		return 0;
+	}
+
+	// Every display checked at this speed: take it, or try the next slower one
+	if (lcd_probe_answered && lcd_probe_healthy)
+	{
+		lcd_bus_speed = lcd_bus_speeds[lcd_probe_index];
+	}
+	else if (lcd_probe_index + 1u < sizeof(lcd_bus_speeds) / sizeof(lcd_bus_speeds[0]))
+	{
+		lcd_probe_try(lcd_probe_index + 1);
+		return 0;
+	}
+	lcd_probe_active = 0;
+	lcd_probe_finish();
+	return 1;
+}
+
+uint32_t lcd_get_bus_speed (void)
+{
+	return hi2c1.Init.ClockSpeed;
+}
+
+/* Put bytes in front of the queued frames (bus stopped); 0 = idle bytes */
+static void lcd_queue_prepend (const uint8_t *bytes, uint16_t len)
+{
+	uint16_t tail = lcd_queue_tail - len;
+	uint16_t i;
+
+	for (i = 0; i < len; i++)
+	{
+		lcd_queue[(uint16_t)(tail + i) % LCD_QUEUE_SIZE] = bytes ? bytes[i] : LCD_IDLE_BYTE;
+	}
+	lcd_queue_tail = tail;
+}
+
+/* Bring the controller back in step with the 4-bit interface before the
+ * frames that are sent again after a recovery. Three 8-bit function sets
+ * and the switch to 4 bits work whatever nibble it was waiting for; the
+ * first one may complete a half-received instruction (up to 1.52ms) or a
+ * character, so the screen is also redrawn. Added in reverse order. */
+static void lcd_queue_resync (void)
+{
+	static const uint8_t function_set[] = { 0x2C, 0x28, 0x8C, 0x88 }; /* 0x28, 4-bit */
+	static const uint8_t nibble_4bit[] = { 0x2C, 0x28, LCD_IDLE_BYTE };
+	static const uint8_t nibble_8bit[] = { 0x3C, 0x38, LCD_IDLE_BYTE };
+	uint16_t wait = (uint16_t)((1520u * (hi2c1.Init.ClockSpeed / 1000u) + 8999u) / 9000u);
+
+	if ((uint16_t)(lcd_queue_head - lcd_queue_tail) >
+	    LCD_QUEUE_SIZE - wait - sizeof(function_set) - sizeof(nibble_4bit) - 3 * sizeof(nibble_8bit))
+	{
+		lcd_queue_tail = lcd_queue_head; // no room: the redraw replaces them
+	}
+	lcd_queue_prepend(function_set, sizeof(function_set));
+	lcd_queue_prepend(nibble_4bit, sizeof(nibble_4bit));
+	lcd_queue_prepend(nibble_8bit, sizeof(nibble_8bit));
+	lcd_queue_prepend(nibble_8bit, sizeof(nibble_8bit));
+	lcd_queue_prepend(0, wait);
+	lcd_queue_prepend(nibble_8bit, sizeof(nibble_8bit));
+	lcd_tx_owner->lost = 1;
+}
+
+/* BUSY with no transfer of ours, seen on two checks in a row */
+static uint8_t lcd_bus_stuck (void)
+{
+	uint8_t stuck = !lcd_tx_busy && __HAL_I2C_GET_FLAG(&hi2c1, I2C_FLAG_BUSY) != RESET;
+	uint8_t seen = lcd_stuck_seen;
+
+	lcd_stuck_seen = stuck;
+	return stuck && seen;
+}
+
+/* Stop the peripheral and take over its pins as open-drain outputs,
+ * released high. A transfer in flight is abandoned; its frames stay
+ * queued and are sent again. Failures before a bus fault say nothing
+ * about the displays, so their error runs start over. */
+static void lcd_recover_begin (void)
+{
+	GPIO_InitTypeDef gpio = {0};
+	LcdHandle *hlcd;
+
+	lcd_stats.recoveries++;
+	lcd_recover_resume = lcd_bus_state;
+	lcd_recover_edge = 0;
+	lcd_stuck_seen = 0;
+	lcd_bus_state = LCD_BUS_RECOVER;
+	HAL_I2C_DeInit(&hi2c1);
+	lcd_tx_busy = 0;
+	lcd_recover_request = 0;
+	for (hlcd = lcd_list; hlcd; hlcd = hlcd->next) hlcd->error_run = 0;
+
+	HAL_GPIO_WritePin(LCD_I2C_PORT, LCD_SCL_PIN | LCD_SDA_PIN, GPIO_PIN_SET);
+	gpio.Pin = LCD_SCL_PIN | LCD_SDA_PIN;
+	gpio.Mode = GPIO_MODE_OUTPUT_OD;
+	gpio.Speed = GPIO_SPEED_FREQ_LOW;
+	HAL_GPIO_Init(LCD_I2C_PORT, &gpio);
+}
+
+/* Bus recovery, one pin edge per call: clock SCL until the slave lets
+ * SDA go (at most 9 pulses), send a STOP, then reset the peripheral.
+ * The bus runs far below 100kHz here, which the PCF8574 (a static
+ * device) does not mind. */
+static uint32_t lcd_recover_step (void)
+{
+	LcdHandle *hlcd;
+	uint8_t edge = lcd_recover_edge++;
+
+	if (edge < 2 * LCD_RECOVER_PULSES)
+	{
+		if (edge & 1)
+		{
+			HAL_GPIO_WritePin(LCD_I2C_PORT, LCD_SCL_PIN, GPIO_PIN_SET);
+			return 1;
+		}
+		if (HAL_GPIO_ReadPin(LCD_I2C_PORT, LCD_SDA_PIN) == GPIO_PIN_RESET)
+		{
+			HAL_GPIO_WritePin(LCD_I2C_PORT, LCD_SCL_PIN, GPIO_PIN_RESET);
+			return 1;
+		}
+		// SDA released (SCL is high): go on with the STOP
+		edge = 2 * LCD_RECOVER_PULSES;
+		lcd_recover_edge = edge + 1;
+	}
+
+	switch (edge - 2 * LCD_RECOVER_PULSES)
+	{
+	case 0:
+		HAL_GPIO_WritePin(LCD_I2C_PORT, LCD_SCL_PIN, GPIO_PIN_RESET);
+		return 1;
+	case 1:
+		HAL_GPIO_WritePin(LCD_I2C_PORT, LCD_SDA_PIN, GPIO_PIN_RESET);
+		return 1;
+	case 2:
+		HAL_GPIO_WritePin(LCD_I2C_PORT, LCD_SCL_PIN, GPIO_PIN_SET);
+		return 1;
+	case 3:
+		HAL_GPIO_WritePin(LCD_I2C_PORT, LCD_SDA_PIN, GPIO_PIN_SET); /* STOP */
+		return 1;
+	default:
+		break;
+	}
+
+	// Software reset of the peripheral, pins back to I2C (HAL_I2C_MspInit)
+	HAL_I2C_Init(&hi2c1);
+	if (__HAL_I2C_GET_FLAG(&hi2c1, I2C_FLAG_BUSY) != RESET)
+	{
+		lcd_stats.recover_failures++;
+		if (++lcd_recover_tries < LCD_RECOVER_TRIES)
+		{
+			lcd_bus_state = lcd_recover_resume;
+			lcd_recover_begin();
+			return 1;
+		}
+		// Give up until the next presence check
+		lcd_recover_tries = 0;
+		lcd_queue_tail = lcd_queue_head;
+		for (hlcd = lcd_list; hlcd; hlcd = hlcd->next)
+		{
+			if (hlcd->state != LCD_STATE_HEADLESS) lcd_stats.headless++;
+			hlcd->state = LCD_STATE_HEADLESS;
+			hlcd->due = HAL_GetTick() + LCD_REPROBE_MS;
+		}
+		lcd_bus_state = LCD_BUS_RUN;
+		return LCD_REPROBE_MS;
+	}
+
+	lcd_recover_tries = 0;
+	lcd_bus_state = lcd_recover_resume;
+	hlcd = lcd_tx_owner;
+	if (lcd_bus_state == LCD_BUS_RUN && hlcd)
+	{
+		if (hlcd->state == LCD_STATE_READY)
+		{
+			lcd_queue_resync();
+			lcd_start_tx();
+		}
+		else if (hlcd->state != LCD_STATE_HEADLESS)
+		{
+			lcd_queue_tail = lcd_queue_head; // initialisation cut short: start over
+			hlcd->state = LCD_STATE_POWER_ON;
+		}
+	}
+	return 1;
+}
+
+/* Queue as many of the custom glyphs as the queue and the budget of the
+ * window have room for (a full set, 8 x 8 characters, is larger than
+ * both). Returns 1 once all are queued. */
+static uint8_t lcd_load_glyphs (LcdHandle *hlcd)
+{
+	uint8_t row;
+
+	if (hlcd->glyph_next >= lcd_glyph_count) return 1;
+	if (lcd_room() < LCD_BATCH_MAX) return 0;
+
+	lcd_batch = 1;
+	lcd_queue_cmd((char)(0x40 | (hlcd->glyph_next << 3))); /* CGRAM address */
+	while (hlcd->glyph_next < lcd_glyph_count && lcd_room() >= 9 * LCD_FRAME_SIZE)
+	{
+		for (row = 0; row < 8; row++) lcd_queue_data((char)lcd_glyphs[hlcd->glyph_next][row]);
+		hlcd->glyph_next++;
+	}
+	lcd_queue_cmd(0x80); /* back to DDRAM */
+	lcd_batch = 0;
+	lcd_start_tx();
+	return hlcd->glyph_next >= lcd_glyph_count;
+}
+
+void lcd_set_glyphs (const uint8_t (*glyphs)[8], uint8_t count)
+{
+	LcdHandle *hlcd;
+
+	lcd_glyphs = glyphs;
+	lcd_glyph_count = count > 8 ? 8 : count;
+	for (hlcd = lcd_list; hlcd; hlcd = hlcd->next)
+	{
+		hlcd->glyph_next = 0;
+		__disable_irq();
+		if (hlcd->state == LCD_STATE_READY) hlcd->state = LCD_STATE_GLYPHS;
+		__enable_irq();
+	}
 }
 
-void lcd_init (void) {
-	lcd_send_cmd (0x33); /* set 4-bits interface */
-	lcd_send_cmd (0x32);
-	HAL_Delay(50);
-	lcd_send_cmd (0x28); /* start to set LCD function */
-	HAL_Delay(50);
-	lcd_send_cmd (0x01); /* clear display */
-	HAL_Delay(50);
-	lcd_send_cmd (0x06); /* set entry mode */
-	HAL_Delay(50);
-	lcd_send_cmd (0x0c); /* set display to on */	
-	HAL_Delay(50);
-	lcd_send_cmd (0x02); /* move cursor to home and set data address to 0 */
-	HAL_Delay(50);
-	lcd_send_cmd (0x80);
+/* The screen was just cleared: everything not blank has to be sent */
+static void lcd_shadow_fill (LcdHandle *hlcd)
+{
+	uint8_t row, col;
+
+	memset(hlcd->shadow, ' ', sizeof(hlcd->shadow));
+	for (row = 0; row < LCD_ROWS; row++)
+	{
+		hlcd->dirty[row] = 0;
+		for (col = 0; col < LCD_COLS; col++)
+		{
+			if (hlcd->text[row][col] != ' ') hlcd->dirty[row] |= 1u << col;
+		}
+	}
+}
+
+/* Switch a display state unless the interrupt made it headless meanwhile */
+static void lcd_set_state (LcdHandle *hlcd, uint8_t from, uint8_t to)
+{
+	__disable_irq();
+	if (hlcd->state == from) hlcd->state = to;
+	__enable_irq();
+}
+
+/* HD44780 initialisation by instruction (4-bit interface) and presence
+ * check of one display, one step per call. Returns the time in ms until
+ * the display needs the next call. Waits of a few hundred us or less are
+ * done on the bus with idle bytes; the 4.1ms after the first function set
+ * is waited here. Custom glyphs are loaded over one or more calls. While
+ * headless each call due sends one address probe (a few hundred us of bus
+ * time) and the whole sequence restarts when the display answers. */
+static uint32_t lcd_step (LcdHandle *hlcd, uint32_t now)
+{
+	if (hlcd->state != LCD_STATE_READY && (int32_t)(now - hlcd->due) < 0) return hlcd->due - now;
+
+	switch (hlcd->state)
+	{
+	case LCD_STATE_POWER_ON:
+		if (!lcd_claim(hlcd)) return 1;
+		lcd_queue_nibble(0x30); /* function set, 8-bit */
+		hlcd->due = now + 5;    /* > 4.1ms */
+		lcd_set_state(hlcd, LCD_STATE_POWER_ON, LCD_STATE_FUNCTION_SET);
+		return 5;
+
+	case LCD_STATE_FUNCTION_SET:
+		if (!lcd_claim(hlcd)) return 1;
+		lcd_batch = 1;
+		lcd_queue_nibble(0x30);
+		lcd_queue_wait_us(100);
+		lcd_queue_nibble(0x30);
+		lcd_queue_nibble(0x20); /* set 4-bits interface */
+		lcd_queue_cmd (0x28);   /* 2 lines, 5x8 font */
+		lcd_queue_cmd (0x08);   /* display off */
+		lcd_queue_cmd (0x01);   /* clear display */
+		lcd_queue_wait_us(1520);
+		lcd_queue_cmd (0x06);   /* set entry mode */
+		lcd_queue_cmd (0x0c);   /* set display to on */
+		lcd_batch = 0;
+		lcd_start_tx();
+		lcd_shadow_fill(hlcd);
+		hlcd->lost = 0;
+		hlcd->glyph_next = 0;
+		lcd_set_state(hlcd, LCD_STATE_FUNCTION_SET, LCD_STATE_GLYPHS);
+		return 1;
+
+	case LCD_STATE_GLYPHS:
+		if (!lcd_claim(hlcd) || !lcd_load_glyphs(hlcd)) return 1;
+		lcd_set_state(hlcd, LCD_STATE_GLYPHS, LCD_STATE_READY);
+		return LCD_REPROBE_MS;
+
+	case LCD_STATE_HEADLESS:
+		// Short probe on an idle bus at the current speed
+		if (lcd_busy() || lcd_tx_busy) return 1;
+		if (__HAL_I2C_GET_FLAG(&hi2c1, I2C_FLAG_BUSY) != RESET)
+		{
+			lcd_recover_begin();
+			return 1;
+		}
+		hlcd->due = now + LCD_REPROBE_MS;
+		if (HAL_I2C_IsDeviceReady(&hi2c1, hlcd->address, 1, 2) != HAL_OK) return LCD_REPROBE_MS;
+		if (lcd_bus_speed == 0)
+		{
+			// First display seen since boot: the bus is still at the
+			// slowest fallback clock, so pick the speed again first
+			lcd_bus_state = LCD_BUS_PROBE;
+			return 1;
+		}
+		hlcd->state = LCD_STATE_POWER_ON;
+		hlcd->due = now;
+		return 1;
+
+	default:
+		return LCD_REPROBE_MS;
+	}
 }
 
-void lcd_send_string (char *str)
+/* Queue the dirty cells of a display within the room left, row by row.
+ * Runs separated by a single clean cell are merged, since skipping it
+ * would cost a cursor command anyway. */
+static void lcd_refresh_display (LcdHandle *hlcd)
 {
-	while (*str) lcd_send_data (*str++);
+	uint8_t row, col, end, fit;
+
+	if (hlcd->lost)
+	{
+		hlcd->lost = 0;
+		hlcd->dirty[0] = hlcd->dirty[1] = LCD_ROW_ALL;
+	}
+
+	lcd_batch = 1;
+	for (row = 0; row < LCD_ROWS; row++)
+	{
+		col = 0;
+		while (col < LCD_COLS)
+		{
+			uint16_t dirty = hlcd->dirty[row];
+
+			if (!(dirty & (1u << col)))
+			{
+				col++;
+				continue;
+			}
+
+			end = col + 1;
+			while (end < LCD_COLS && ((dirty & (1u << end)) ||
+			       (end + 1 < LCD_COLS && (dirty & (1u << (end + 1))))))
+			{
+				end++;
+			}
+
+			// Cursor command plus as many characters as the budget allows
+			fit = (uint8_t)(lcd_room() / LCD_FRAME_SIZE);
+			if (fit < 2) goto out;
+			if (end - col > fit - 1) end = col + fit - 1;
+
+			lcd_queue_goto(row, col);
+			for (; col < end; col++)
+			{
+				lcd_queue_data(hlcd->text[row][col]);
+				hlcd->shadow[row][col] = hlcd->text[row][col];
+				hlcd->dirty[row] &= (uint16_t)~(1u << col);
+			}
+		}
+	}
+out:
+	lcd_batch = 0;
+	lcd_start_tx();
 }
 
-void lcd_clear_display (void)
+/* Send dirty cells, taking the displays round-robin, until the budget of
+ * the window is spent or the queue holds another display's frames.
+ * Returns 1 if dirty cells are left. */
+static uint8_t lcd_refresh (void)
 {
-	lcd_send_cmd (0x01); //clear display
+	LcdHandle *hlcd = lcd_refresh_next ? lcd_refresh_next : lcd_list;
+	LcdHandle *first = hlcd;
+	uint8_t pending = 0;
+
+	if (!hlcd) return 0;
+	do
+	{
+		if (hlcd->state == LCD_STATE_READY && (hlcd->lost || hlcd->dirty[0] || hlcd->dirty[1]))
+		{
+			if (lcd_room() < 2 * LCD_FRAME_SIZE || !lcd_claim(hlcd)) break;
+			lcd_refresh_display(hlcd);
+		}
+		hlcd = hlcd->next ? hlcd->next : lcd_list;
+	} while (hlcd != first);
+	lcd_refresh_next = hlcd;
+
+	for (hlcd = lcd_list; hlcd; hlcd = hlcd->next)
+	{
+		if (hlcd->state == LCD_STATE_READY && (hlcd->lost || hlcd->dirty[0] || hlcd->dirty[1])) pending = 1;
+	}
+	return pending;
 }
 
-void lcd_goto_XY (int row, int col)
+/* Bus service (scheduler task): power-on wait and speed probe, bus
+ * recovery, initialisation and presence checks of every display, then
+ * the refresh of dirty cells. Returns the time in ms until the next call
+ * is needed. */
+uint32_t lcd_service (void)
 {
-	uint8_t pos_Addr;
-	if(row == 1) 
+	uint32_t now = HAL_GetTick();
+	uint32_t wait = LCD_REPROBE_MS;
+	uint32_t step;
+	LcdHandle *hlcd;
+
+	// Frames left for a display the interrupt made headless: nothing
+	// transmits them any more, so they can go
+	if (lcd_queue_drop)
+	{
+		lcd_queue_drop = 0;
+		lcd_queue_tail = lcd_queue_head;
+	}
+
+	switch (lcd_bus_state)
+	{
+	case LCD_BUS_PROBE:
+		// Power-on: 40ms after Vcc reached 2.7V, counted from reset
+		if (now < LCD_POWER_ON_MS) return LCD_POWER_ON_MS - now;
+		if (__HAL_I2C_GET_FLAG(&hi2c1, I2C_FLAG_BUSY) != RESET)
+		{
+			lcd_recover_begin();
+			return 1;
+		}
+		if (!lcd_probe_step()) return 1;
+		lcd_bus_state = LCD_BUS_RUN;
+		break;
+
+	case LCD_BUS_RECOVER:
+		return lcd_recover_step();
+
+	default:
+		if (lcd_recover_request || lcd_bus_stuck())
+		{
+			lcd_recover_begin();
+			return 1;
+		}
+		lcd_start_tx(); // frames held back while the bus was busy
+		break;
+	}
+
+	// New window: refill the budget (bytes the bus sends in LCD_BUS_BUDGET_US),
+	// at least one glyph so that slow buses can still load them
+	if (now - lcd_budget_window >= LCD_BUS_WINDOW_MS)
 	{
-		pos_Addr = 0x80 + row - 1 + col;
+		lcd_budget_window = now;
+		lcd_budget_left = (uint16_t)(LCD_BUS_BUDGET_US * (hi2c1.Init.ClockSpeed / 1000u) / 9000u);
+		if (lcd_budget_left < LCD_BATCH_MAX) lcd_budget_left = LCD_BATCH_MAX;
 	}
-	else
+
+	for (hlcd = lcd_list; hlcd && lcd_bus_state == LCD_BUS_RUN; hlcd = hlcd->next)
 	{
-		pos_Addr = 0x80 | (0x40 + col);
+		step = lcd_step(hlcd, now);
+		if (step < wait) wait = step;
 	}
-	lcd_send_cmd(pos_Addr);
+	if (lcd_bus_state != LCD_BUS_RUN) return 1;
+
+	if ((lcd_refresh() || lcd_busy()) && wait > LCD_BUS_WINDOW_MS) wait = LCD_BUS_WINDOW_MS;
+	return wait;
+}
+
+void lcd_attach (LcdHandle *hlcd, uint16_t address)
+{
+	LcdHandle **link = &lcd_list;
+
+	memset(hlcd, 0, sizeof(*hlcd));
+	hlcd->address = address;
+	memset(hlcd->text, ' ', sizeof(hlcd->text));
+	memset(hlcd->shadow, ' ', sizeof(hlcd->shadow));
+	hlcd->state = LCD_STATE_POWER_ON;
+	while (*link) link = &(*link)->next;
+	*link = hlcd;
+}
+
+uint8_t lcd_ready (LcdHandle *hlcd)
+{
+	return hlcd->state == LCD_STATE_READY;
 }
 
-void lcd_display_2lines(char* line1, char* line2)
+uint8_t lcd_headless (LcdHandle *hlcd)
 {
-	lcd_clear_display();
-	lcd_goto_XY(1, 0);
-	lcd_send_string(line1);
-	lcd_goto_XY(2, 0);
-	lcd_send_string(line2);
+	return hlcd->state == LCD_STATE_HEADLESS;
 }
 
+/* Glyphs are loaded right after the function set, so a ready display
+ * has all of them; one being (re)initialised has none it can rely on */
+uint8_t lcd_glyphs_ready (LcdHandle *hlcd)
+{
+	return hlcd->state == LCD_STATE_READY && hlcd->glyph_next >= lcd_glyph_count;
+}
+
+void lcd_invalidate (LcdHandle *hlcd)
+{
+	hlcd->lost = 1; // next refresh redraws everything
+}
+
+/* Set the text of one row (padded with spaces, cut at LCD_COLS) and mark
+ * the cells that differ from the screen */
+static void lcd_set_row (LcdHandle *hlcd, uint8_t row, const char *text)
+{
+	uint16_t dirty = 0;
+	uint8_t col;
+	char c;
 
+	for (col = 0; col < LCD_COLS; col++)
+	{
+		c = *text ? *text++ : ' ';
+		hlcd->text[row][col] = c;
+		if (c != hlcd->shadow[row][col]) dirty |= 1u << col;
+	}
+	hlcd->dirty[row] |= dirty;
+}
+
+void lcd_display_2lines (LcdHandle *hlcd, const char* line1, const char* line2)
+{
+	lcd_set_row(hlcd, 0, line1);
+	lcd_set_row(hlcd, 1, line2);
+}
@@ -0,0 +1,199 @@
+/*
+ * idle.c
+ * Tickless idle implementation
+ *
+ * When nothing is due for several ticks, the auto-reload of TIM2 is
+ * stretched so the next update interrupt arrives at the next deadline,
+ * and the core sleeps with WFI. timer_run() then counts all the ticks
+ * covered by that single interrupt. If another interrupt wakes the
+ * core early, the whole ticks elapsed so far are accounted here and TIM2
+ * is put back to its normal period without losing the tick phase.
+ *
+ * The HAL SysTick (1ms, HAL_GetTick()) is suspended while asleep, or it
+ * would end every WFI within a millisecond; the time slept is credited
+ * to the HAL tick on wakeup, from the TIM2 counts.
+ *
+ * Stop mode is not used: it halts TIM2, and would need the RTC alarm as
+ * wakeup source and a clock reconfiguration after every wakeup.
+ */
+
+#include "idle.h"
+#include "main.h"
+#include "sched.h"
+#include "swtimer.h"
+#include "timer.h"
+#include "button.h"
+#include "matrix.h"
+
+extern TIM_HandleTypeDef htim2;
+
+// TIM2 counts per 10ms tick and longest stretch the 16-bit ARR allows
+static uint32_t idle_tick_counts = 1;
+static uint32_t idle_max_ticks = 1;
+
+// Totals (whole ticks plus leftover counts) and current statistics window
+static uint32_t idle_wakeups = 0;
+static uint32_t idle_sleep_ticks = 0;
+static uint32_t idle_sleep_counts = 0;
+static uint32_t idle_window_start = 0;
+static uint32_t idle_window_wakeups = 0;
+static uint32_t idle_window_counts = 0;
+static uint16_t idle_wakeups_per_s = 0;
+static uint16_t idle_sleep_permille = 0;
+
+// TIM2 counts slept, times 10, not credited to the HAL tick yet (< 1ms)
+static uint32_t idle_hal_counts = 0;
+
+/**
+ * @brief Initialize tickless idle (call after MX_TIM2_Init)
+ */
+void idle_init(void) {
+    idle_tick_counts = htim2.Init.Period + 1;
+    idle_max_ticks = 0x10000u / idle_tick_counts;
+    if (idle_max_ticks > IDLE_MAX_TICKS) {
+        idle_max_ticks = IDLE_MAX_TICKS;
+    }
+
+    idle_wakeups = 0;
+    idle_sleep_ticks = 0;
+    idle_sleep_counts = 0;
+    idle_window_start = SWT_Get_Tick();
+    idle_window_wakeups = 0;
+    idle_window_counts = 0;
+    idle_wakeups_per_s = 0;
+    idle_sleep_permille = 0;
+    idle_hal_counts = 0;
+
+#ifdef DEBUG
+    // Keep the debugger connected while the core sleeps
+    HAL_DBGMCU_EnableDBGSleepMode();
+#endif
+}
+
+/**
+ * @brief Close the statistics window once a second has passed
+ */
+static void idle_update_window(void) {
+    uint32_t now = SWT_Get_Tick();
+    uint32_t counts;
+
+    if (now - idle_window_start < IDLE_WINDOW_TICKS) return;
+
+    counts = (now - idle_window_start) * idle_tick_counts;
+    idle_wakeups_per_s = (uint16_t)(idle_window_wakeups * IDLE_WINDOW_TICKS / (now - idle_window_start));
+    idle_sleep_permille = (uint16_t)(idle_window_counts / (counts / 1000u));
+    if (idle_sleep_permille > 1000) idle_sleep_permille = 1000;
+
+    idle_window_start = now;
+    idle_window_wakeups = 0;
+    idle_window_counts = 0;
+}
+
+/**
+ * @brief Sleep until the next deadline - call from the main loop
+ * Returns immediately if a task or timer is already due.
+ */
+void idle_enter(void) {
+    uint32_t ticks;
+    uint32_t next;
+    uint32_t start;
+    uint32_t slept;
+    uint8_t sampling;
+
+    __disable_irq();
+
+    // Unprocessed or pending tick, or due work: do not sleep
+    ticks = SCH_Next_Due();
+    next = SWT_Next_Expiry();
+    if (next < ticks) ticks = next;
+    if (ticks == 0 || timer_pending() != 0 ||
+        __HAL_TIM_GET_FLAG(&htim2, TIM_FLAG_UPDATE)) {
+        __enable_irq();
+        return;
+    }
+    if (ticks > idle_max_ticks) ticks = idle_max_ticks;
+    sampling = button_sampling();
+    if (matrix_sampling() > sampling) sampling = matrix_sampling();
+    switch (sampling) {
+        case BUTTON_SAMPLE_TICK:
+            ticks = 1;
+            break;
+        case BUTTON_SAMPLE_POLL:
+            if (ticks > IDLE_INPUT_POLL_TICKS) ticks = IDLE_INPUT_POLL_TICKS;
+            break;
+        default:
+            // Buttons wake the core through EXTI
+            break;
+    }
+
+    // Stretch the current tick period over the whole idle span
+    start = __HAL_TIM_GET_COUNTER(&htim2);
+    if (ticks > 1) {
+        htim2.Instance->ARR = ticks * idle_tick_counts - 1;
+        timer_set_period_ticks(ticks);
+        if (__HAL_TIM_GET_FLAG(&htim2, TIM_FLAG_UPDATE)) {
+            // The tick ended before the new period took effect
+            htim2.Instance->ARR = idle_tick_counts - 1;
+            timer_set_period_ticks(1);
+            ticks = 1;
+        }
+    }
+
+    HAL_SuspendTick();
+    __DSB();
+    __WFI();
+
+    // Awake: interrupts stay masked until the accounting is consistent
+    if (__HAL_TIM_GET_FLAG(&htim2, TIM_FLAG_UPDATE)) {
+        // Full span elapsed, timer_run() counts it
+        slept = ticks * idle_tick_counts - start + __HAL_TIM_GET_COUNTER(&htim2);
+        if (ticks > 1) {
+            htim2.Instance->ARR = idle_tick_counts - 1;
+        }
+    } else {
+        uint32_t count = __HAL_TIM_GET_COUNTER(&htim2);
+        slept = count - start;
+        if (ticks > 1) {
+            // Woken early by another interrupt: count the whole ticks
+            // here and finish the current tick with the normal period
+            uint32_t whole = count / idle_tick_counts;
+            __HAL_TIM_SET_COUNTER(&htim2, count - whole * idle_tick_counts);
+            htim2.Instance->ARR = idle_tick_counts - 1;
+            timer_set_period_ticks(1);
+            if (whole > 0) {
+                timer_add_ticks(whole);
+            }
+        }
+    }
+
+    // Milliseconds the suspended SysTick missed (uwTick counts ms); its
+    // counter kept running, so the 1ms phase is unchanged
+    idle_hal_counts += slept * 10u;
+    uwTick += idle_hal_counts / idle_tick_counts;
+    idle_hal_counts %= idle_tick_counts;
+    HAL_ResumeTick();
+
+    idle_wakeups++;
+    idle_sleep_counts += slept;
+    idle_sleep_ticks += idle_sleep_counts / idle_tick_counts;
+    idle_sleep_counts %= idle_tick_counts;
+    idle_window_wakeups++;
+    idle_window_counts += slept;
+
+    __enable_irq();
+
+    idle_update_window();
+}
+
+/**
+ * @brief Get sleep statistics
+ * @param stats: Output structure
+ */
+void idle_get_stats(IdleStats *stats) {
+    __disable_irq();
+    stats->wakeups = idle_wakeups;
+    stats->sleep_ms = idle_sleep_ticks * 10u;
+    stats->wakeups_per_s = idle_wakeups_per_s;
+    stats->sleep_permille = idle_sleep_permille;
+    __enable_irq();
+}
@@ -0,0 +1,86 @@
+/*
+ * input_event.c
+ * Input event queue implementation
+ *
+ * A ring of INPUT_EVENT_QUEUE_SIZE events with free-running head/tail
+ * counters: the producer only writes head, the consumer only writes tail.
+ * Auto-repeat events are only queued while the queue is less than 3/4
+ * full, so a stalled consumer never costs a press or release.
+ */
+
+#include "input_event.h"
+#include "stm32f1xx_hal.h"
+
+#if (INPUT_EVENT_QUEUE_SIZE & (INPUT_EVENT_QUEUE_SIZE - 1)) != 0
+#error "INPUT_EVENT_QUEUE_SIZE must be a power of 2"
+#endif
+
+#define INPUT_EVENT_MASK  (INPUT_EVENT_QUEUE_SIZE - 1u)
+
+static InputEvent input_event_queue[INPUT_EVENT_QUEUE_SIZE];
+static volatile uint32_t input_event_head = 0;     // Written by the producer
+static volatile uint32_t input_event_tail = 0;     // Written by the consumer
+static volatile uint32_t input_event_drops = 0;    // Events lost to a full queue
+
+/**
+ * @brief Empty the queue
+ */
+void input_event_init(void) {
+    input_event_head = 0;
+    input_event_tail = 0;
+    input_event_drops = 0;
+}
+
+/**
+ * @brief Queue an event (producer side)
+ * @param input: Input index
+ * @param type: INPUT_EVENT_*
+ * @param time: Tick the event was detected
+ * @return 1 if queued, 0 if dropped (queue full, or repeat with little room)
+ */
+uint8_t input_event_post(uint8_t input, uint8_t type, uint32_t time) {
+    uint32_t head = input_event_head;
+    uint32_t used = head - input_event_tail;
+    InputEvent *event;
+
+    if (used >= INPUT_EVENT_QUEUE_SIZE ||
+        (type == INPUT_EVENT_REPEAT && used >= INPUT_EVENT_QUEUE_SIZE * 3 / 4)) {
+        input_event_drops++;
+        return 0;
+    }
+
+    event = &input_event_queue[head & INPUT_EVENT_MASK];
+    event->time = time;
+    event->input = input;
+    event->type = type;
+
+    // Publish the event only after it is written
+    __DMB();
+    input_event_head = head + 1;
+    return 1;
+}
+
+/**
+ * @brief Take the oldest event (consumer side)
+ * @param event: Output event
+ * @return 1 if an event was taken, 0 if the queue is empty
+ */
+uint8_t input_event_get(InputEvent *event) {
+    uint32_t tail = input_event_tail;
+
+    if (tail == input_event_head) return 0;
+
+    __DMB();
+    *event = input_event_queue[tail & INPUT_EVENT_MASK];
+    __DMB();
+    input_event_tail = tail + 1;
+    return 1;
+}
+
+/**
+ * @brief Number of events dropped because the queue was full
+ * @return Drop count since input_event_init()
+ */
+uint32_t input_event_dropped(void) {
+    return input_event_drops;
+}
@@ -0,0 +1,66 @@
+/*
+ * lcd_text.c
+ * printf-free text formatting for the 16x2 LCD
+ */
+
+#include "lcd_text.h"
+
+#define LCD_TEXT_TENS(t) \
+    {t, '0'}, {t, '1'}, {t, '2'}, {t, '3'}, {t, '4'}, \
+    {t, '5'}, {t, '6'}, {t, '7'}, {t, '8'}, {t, '9'}
+
+const char lcd_text_digits[100][2] = {
+    LCD_TEXT_TENS('0'), LCD_TEXT_TENS('1'), LCD_TEXT_TENS('2'), LCD_TEXT_TENS('3'),
+    LCD_TEXT_TENS('4'), LCD_TEXT_TENS('5'), LCD_TEXT_TENS('6'), LCD_TEXT_TENS('7'),
+    LCD_TEXT_TENS('8'), LCD_TEXT_TENS('9')
+};
+
+// Glyph rows (5 pixels wide): rounded corners, top/bottom bars and the
+// two middle bars of 2, 3, 5, 6, 8 and 9
+const uint8_t lcd_text_big_glyphs[LCD_BIG_GLYPHS][8] = {
+    {0x07, 0x0F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},  // 0: upper left
+    {0x1F, 0x1F, 0x1F, 0x00, 0x00, 0x00, 0x00, 0x00},  // 1: upper bar
+    {0x1C, 0x1E, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},  // 2: upper right
+    {0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x0F, 0x07},  // 3: lower left
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F},  // 4: lower bar
+    {0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1E, 0x1C},  // 5: lower right
+    {0x1F, 0x1F, 0x1F, 0x00, 0x00, 0x00, 0x1F, 0x1F},  // 6: upper and middle bar
+    {0x1F, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F}   // 7: middle and lower bar
+};
+
+#define G(n)   LCD_GLYPH(n)
+#define FULL   ((char)0xFF)  // full block in the character ROM
+
+// Top and bottom rows of each digit
+static const char lcd_text_big_top[10][LCD_BIG_DIGIT_COLS] = {
+    {G(0), G(1), G(2)}, {G(1), G(2), ' '},  {G(6), G(6), G(2)}, {G(6), G(6), G(2)},
+    {G(3), G(4), FULL}, {FULL, G(6), G(6)}, {G(0), G(6), G(6)}, {G(1), G(1), G(2)},
+    {G(0), G(6), G(2)}, {G(0), G(6), G(2)}
+};
+static const char lcd_text_big_bottom[10][LCD_BIG_DIGIT_COLS] = {
+    {G(3), G(4), G(5)}, {G(4), FULL, G(4)}, {G(3), G(7), G(7)}, {G(7), G(7), G(5)},
+    {' ',  ' ',  FULL}, {G(7), G(7), G(5)}, {G(3), G(7), G(5)}, {' ',  ' ',  FULL},
+    {G(3), G(7), G(5)}, {G(7), G(7), G(5)}
+};
+
+#undef G
+#undef FULL
+
+/**
+ * @brief Write a number as two big digits (6 columns on two rows)
+ * @param top: First column of the digits on the upper line
+ * @param bottom: First column of the digits on the lower line
+ * @param value: Number to write, values above 99 show as 99
+ */
+void lcd_text_put_big2(char *top, char *bottom, uint8_t value) {
+    const char *pair;
+    uint8_t i;
+
+    if (value > 99) value = 99;
+    pair = lcd_text_digits[value];
+    for (i = 0; i < 2; i++) {
+        uint8_t digit = (uint8_t)(pair[i] - '0');
+        memcpy(&top[i * LCD_BIG_DIGIT_COLS], lcd_text_big_top[digit], LCD_BIG_DIGIT_COLS);
+        memcpy(&bottom[i * LCD_BIG_DIGIT_COLS], lcd_text_big_bottom[digit], LCD_BIG_DIGIT_COLS);
+    }
+}
@@ -24,7 +24,13 @@
 #include "global.h"
 #include "timer.h"
 #include "sched.h"
+#include "task_manifest.h"
+#include "swtimer.h"
+#include "idle.h"
+#include "prof.h"
+#include "input_event.h"
 #include "button.h"
+#include "matrix.h"
 #include "light.h"
 #include "i2c-lcd.h"
 #include "fsm.h"
@@ -108,20 +114,20 @@ int main(void)
   // Initialize modules
   global_init();
   timer_init();
+  input_event_init();
   button_init();
+  matrix_init();
   light_init();
   SCH_Init();
+  SWT_Init();
+  idle_init();
+  prof_init();
   fsm_init();
   
-  // Initialize LCD
-  lcd_init();
-  
-  // Add tasks to scheduler
-  SCH_Add_Task(fsm_run, 0, 100);              // FSM run every 1 second
-  SCH_Add_Task(fsm_button_scan, 0, 1);        // Button scan every 10ms
-  SCH_Add_Task(fsm_countdown_update, 100, 100); // Countdown every 1 second
-  SCH_Add_Task(fsm_lcd_update, 0, 10);        // LCD update every 100ms
-  SCH_Add_Task(fsm_flash_update, 50, 50);     // Flash update every 500ms
+  // Load the task table (see task_manifest.h)
+  SCH_Load_Table(task_table, TASK_COUNT);
+  button_set_event_task(TASK_HANDLE(BUTTON_SCAN));
+  matrix_set_event_task(TASK_HANDLE(BUTTON_SCAN));
   
   // Start timer
   HAL_TIM_Base_Start_IT(&htim2);
@@ -136,7 +142,10 @@ int main(void)
   /* USER CODE BEGIN WHILE */
   while (1)
   {
+	  timer_process();
 	  SCH_Dispatch_Tasks();
+	  SWT_Dispatch();
+	  idle_enter();
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
@@ -0,0 +1,241 @@
+/*
+ * matrix.c
+ * Scanned input matrix implementation
+ *
+ * Each tick the latest column sample of every row is packed into a
+ * 64-bit contact map (bit row * MATRIX_COLS + column) and debounced as
+ * two 32-bit words, so the cost per tick is MATRIX_ROWS port reads, two
+ * debounce updates and one event per contact edge, independent of how
+ * many contacts are closed. Contacts need a series diode each if more
+ * than two can be closed at once (ghosting).
+ *
+ * With MATRIX_USE_DMA, TIM3 steps through the rows in the background:
+ * its update event makes DMA1 channel 3 write the next row pattern to
+ * the row port BSRR, and compare channel 1, half a row later, makes DMA1
+ * channel 6 copy the column port IDR into matrix_samples[row]. The CPU
+ * only reads the buffer, and nothing needs an interrupt.
+ */
+
+#include "matrix.h"
+#include "debounce.h"
+#include "input_event.h"
+#include "sched.h"
+#include "swtimer.h"
+
+#if MATRIX_ENABLE
+
+#if MATRIX_ROWS * MATRIX_COLS > 64 || MATRIX_ROWS < 1 || MATRIX_COLS < 1
+#error "The matrix supports 1..64 contacts"
+#endif
+
+#define MATRIX_ROW_MASK  (((1u << MATRIX_ROWS) - 1u) << MATRIX_ROW_SHIFT)
+#define MATRIX_COL_BITS  ((1u << MATRIX_COLS) - 1u)
+#define MATRIX_COL_MASK  (MATRIX_COL_BITS << MATRIX_COL_SHIFT)
+
+// Debouncers for contacts 0..31 and 32..63
+static DebouncePort matrix_db[2];
+
+// Column port IDR sampled while each row was driven
+static volatile uint32_t matrix_samples[MATRIX_ROWS];
+
+#if MATRIX_USE_DMA
+// BSRR value driving row (k + 1) % MATRIX_ROWS low: written on the update
+// event that ends row k, so sample k is always taken with row k driven
+static uint32_t matrix_row_pattern[MATRIX_ROWS];
+#endif
+
+// Scheduler event task released on every queued matrix event
+static uint32_t matrix_event_task = SCH_INVALID_HANDLE;
+
+/**
+ * @brief BSRR value that drives one row low and releases the others
+ */
+static uint32_t matrix_row_bsrr(uint8_t row) {
+    uint32_t bit = 1u << (MATRIX_ROW_SHIFT + row);
+    return (MATRIX_ROW_MASK & ~bit) | (bit << 16);
+}
+
+#if MATRIX_USE_DMA
+/**
+ * @brief Start the background scan (TIM3 + DMA1 channels 3 and 6)
+ * Registers are set directly: the transfers run forever in circular mode
+ * and need no HAL handles or interrupts.
+ */
+static void matrix_dma_start(void) {
+    uint32_t clock = HAL_RCC_GetPCLK1Freq();
+    uint8_t r;
+
+    for (r = 0; r < MATRIX_ROWS; r++) {
+        matrix_row_pattern[r] = matrix_row_bsrr((uint8_t)((r + 1u) % MATRIX_ROWS));
+    }
+    MATRIX_ROW_PORT->BSRR = matrix_row_bsrr(0);
+
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    __HAL_RCC_TIM3_CLK_ENABLE();
+
+    // Channel 3 (TIM3_UP): row pattern table -> row port BSRR
+    DMA1_Channel3->CCR = 0;
+    DMA1_Channel3->CPAR = (uint32_t)(uintptr_t)&MATRIX_ROW_PORT->BSRR;
+    DMA1_Channel3->CMAR = (uint32_t)(uintptr_t)matrix_row_pattern;
+    DMA1_Channel3->CNDTR = MATRIX_ROWS;
+    DMA1_Channel3->CCR = DMA_CCR_MSIZE_1 | DMA_CCR_PSIZE_1 | DMA_CCR_MINC |
+                         DMA_CCR_CIRC | DMA_CCR_DIR | DMA_CCR_EN;
+
+    // Channel 6 (TIM3_CH1): column port IDR -> matrix_samples
+    DMA1_Channel6->CCR = 0;
+    DMA1_Channel6->CPAR = (uint32_t)(uintptr_t)&MATRIX_COL_PORT->IDR;
+    DMA1_Channel6->CMAR = (uint32_t)(uintptr_t)matrix_samples;
+    DMA1_Channel6->CNDTR = MATRIX_ROWS;
+    DMA1_Channel6->CCR = DMA_CCR_MSIZE_1 | DMA_CCR_PSIZE_1 | DMA_CCR_MINC |
+                         DMA_CCR_CIRC | DMA_CCR_EN;
+
+    // TIM3 at 1MHz: one row per MATRIX_ROW_US, columns read halfway
+    if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1) clock *= 2u;
+    TIM3->CR1 = 0;
+    TIM3->PSC = clock / 1000000u - 1u;
+    TIM3->ARR = MATRIX_ROW_US - 1u;
+    TIM3->CCR1 = MATRIX_ROW_US / 2u;
+    TIM3->CCMR1 = 0;    // CC1 output compare, frozen: only the DMA request
+    TIM3->EGR = TIM_EGR_UG;
+    TIM3->SR = 0;
+    TIM3->DIER = TIM_DIER_UDE | TIM_DIER_CC1DE;
+    TIM3->CR1 = TIM_CR1_CEN;
+}
+#else
+/**
+ * @brief Drive each row in turn and sample the columns (CPU scan)
+ */
+static void matrix_cpu_scan(void) {
+    uint8_t r;
+    volatile uint32_t settle;
+
+    for (r = 0; r < MATRIX_ROWS; r++) {
+        MATRIX_ROW_PORT->BSRR = matrix_row_bsrr(r);
+        for (settle = 0; settle < MATRIX_SETTLE_LOOPS; settle++) {}
+        matrix_samples[r] = MATRIX_COL_PORT->IDR;
+    }
+    MATRIX_ROW_PORT->BSRR = MATRIX_ROW_MASK;    // release all rows
+}
+#endif
+
+/**
+ * @brief Initialize the matrix pins and start scanning (call after MX_GPIO_Init)
+ */
+void matrix_init(void) {
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+    uint8_t r;
+
+    __HAL_RCC_GPIOB_CLK_ENABLE();
+    __HAL_RCC_GPIOC_CLK_ENABLE();
+
+    // Rows: open-drain, released (high-Z) until scanned
+    MATRIX_ROW_PORT->BSRR = MATRIX_ROW_MASK;
+    GPIO_InitStruct.Pin = MATRIX_ROW_MASK;
+    GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_OD;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+    HAL_GPIO_Init(MATRIX_ROW_PORT, &GPIO_InitStruct);
+
+    // Columns: inputs with pull-up, a closed contact reads 0
+    GPIO_InitStruct.Pin = MATRIX_COL_MASK;
+    GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
+    GPIO_InitStruct.Pull = GPIO_PULLUP;
+    HAL_GPIO_Init(MATRIX_COL_PORT, &GPIO_InitStruct);
+
+    // All contacts are active low once packed
+    debounce_init(&matrix_db[0], 0, MATRIX_INPUTS >= 32 ? 0xFFFFFFFFu : (1u << MATRIX_INPUTS) - 1u, 0xFFFFFFFFu);
+    debounce_init(&matrix_db[1], 0, MATRIX_INPUTS > 32 ? 0xFFFFFFFFu >> (64 - MATRIX_INPUTS) : 0u, 0xFFFFFFFFu);
+
+    for (r = 0; r < MATRIX_ROWS; r++) {
+        matrix_samples[r] = MATRIX_COL_MASK;
+    }
+    matrix_event_task = SCH_INVALID_HANDLE;
+
+#if MATRIX_USE_DMA
+    matrix_dma_start();
+#endif
+}
+
+/**
+ * @brief Register the task to signal when a matrix event is queued
+ * @param handle: Event task handle (SCH_INVALID_HANDLE to disable)
+ */
+void matrix_set_event_task(uint32_t handle) {
+    matrix_event_task = handle;
+}
+
+/**
+ * @brief Queue press/release events for the contacts in an edge mask
+ * Only the changed bits are visited (highest first, one CLZ each).
+ */
+static void matrix_post_edges(uint32_t edges, uint8_t base, uint8_t type, uint32_t now) {
+    while (edges != 0) {
+        uint8_t bit = (uint8_t)(31u - __CLZ(edges));
+
+        edges &= ~(1u << bit);
+        if (input_event_post((uint8_t)(MATRIX_INPUT_BASE + base + bit), type, now)) {
+            SCH_Signal(matrix_event_task);
+        }
+    }
+}
+
+/**
+ * @brief Debounce the latest matrix samples - called once per timer pass
+ */
+void matrix_scan(void) {
+    uint64_t contacts = 0;
+    uint32_t changed;
+    uint32_t now;
+    uint8_t r, w;
+
+#if !MATRIX_USE_DMA
+    matrix_cpu_scan();
+#endif
+
+    // Bit row * MATRIX_COLS + column, still active low
+    for (r = 0; r < MATRIX_ROWS; r++) {
+        uint32_t cols = (matrix_samples[r] >> MATRIX_COL_SHIFT) & MATRIX_COL_BITS;
+        contacts |= (uint64_t)cols << (r * MATRIX_COLS);
+    }
+
+    changed = debounce_update(&matrix_db[0], (uint32_t)contacts);
+    changed |= debounce_update(&matrix_db[1], (uint32_t)(contacts >> 32));
+    if (changed == 0) return;
+
+    now = SWT_Get_Tick();
+    for (w = 0; w < 2; w++) {
+        matrix_post_edges(matrix_db[w].pressed, (uint8_t)(w * 32u), INPUT_EVENT_PRESS, now);
+        matrix_post_edges(matrix_db[w].released, (uint8_t)(w * 32u), INPUT_EVENT_RELEASE, now);
+    }
+}
+
+/**
+ * @brief How often the matrix must be debounced right now
+ * The scan itself cannot wake the core, so an idle matrix is polled.
+ * @return BUTTON_SAMPLE_TICK while a contact is closed or settling,
+ *         BUTTON_SAMPLE_POLL otherwise
+ */
+uint8_t matrix_sampling(void) {
+    if (debounce_busy(&matrix_db[0]) || debounce_busy(&matrix_db[1])) {
+        return BUTTON_SAMPLE_TICK;
+    }
+    return BUTTON_SAMPLE_POLL;
+}
+
+#else /* !MATRIX_ENABLE */
+
+void matrix_init(void) {
+}
+
+void matrix_set_event_task(uint32_t handle) {
+    (void)handle;
+}
+
+void matrix_scan(void) {
+}
+
+uint8_t matrix_sampling(void) {
+    return BUTTON_SAMPLE_NONE;
+}
+
+#endif /* MATRIX_ENABLE */
@@ -0,0 +1,246 @@
+/*
+ * prof.c
+ * Execution-time profiling implementation
+ *
+ * Samples are taken with the DWT cycle counter (one register read before
+ * and after the measured code), so profiling can stay enabled in release
+ * builds. Task statistics are kept by the scheduler; the TIM2 interrupt
+ * is measured in stm32f1xx_it.c. prof_dump() prints them, together with
+ * the scheduler's release jitter histograms, over USART2 without pulling
+ * in printf. The I2C traffic of the LCD is printed as well.
+ */
+
+#include "prof.h"
+#include "sched.h"
+#include "i2c-lcd.h"
+#include "main.h"
+
+extern UART_HandleTypeDef huart2;
+
+// USART2 speed (see MX_USART2_UART_Init), and ms to send len bytes at it
+// (10 bits per byte, rounded up)
+#define PROF_UART_BAUD  115200u
+#define PROF_UART_MS(len)  (((uint32_t)(len) * 10000u + PROF_UART_BAUD - 1u) / PROF_UART_BAUD)
+
+// TIM2 interrupt statistics
+ProfStats prof_tick_isr;
+
+// Set from interrupt context (e.g. B1 button) to request a dump
+static volatile uint8_t prof_dump_flag = 0;
+
+/**
+ * @brief Enable the DWT cycle counter and clear statistics
+ */
+void prof_init(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    prof_reset(&prof_tick_isr);
+    SCH_Reset_Stats();
+    prof_dump_flag = 0;
+}
+
+/**
+ * @brief Mean of a statistics record
+ * @param stats: Record
+ * @return Mean cycles per sample (0 if no samples)
+ */
+uint32_t prof_mean(const ProfStats *stats) {
+    if (stats->count == 0) return 0;
+    return (uint32_t)(stats->total / stats->count);
+}
+
+/**
+ * @brief Get a consistent copy of the TIM2 interrupt statistics
+ * @param stats: Output structure
+ */
+void prof_get_isr_stats(ProfStats *stats) {
+    __disable_irq();
+    *stats = prof_tick_isr;
+    __enable_irq();
+}
+
+/**
+ * @brief Request a UART dump (safe to call from an interrupt)
+ */
+void prof_request_dump(void) {
+    prof_dump_flag = 1;
+}
+
+/**
+ * @brief Print the statistics if a dump was requested (scheduler task)
+ */
+void prof_service(void) {
+    if (!prof_dump_flag) return;
+    prof_dump_flag = 0;
+    prof_dump();
+}
+
+/**
+ * @brief Write a right-aligned decimal number
+ * @return Pointer past the last written character
+ */
+static char *prof_put_dec(char *p, uint32_t value, uint8_t width) {
+    char digits[10];
+    uint8_t n = 0;
+
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    while (width > n) {
+        *p++ = ' ';
+        width--;
+    }
+    while (n > 0) {
+        *p++ = digits[--n];
+    }
+    return p;
+}
+
+/**
+ * @brief Write an 8-digit hexadecimal number
+ * @return Pointer past the last written character
+ */
+static char *prof_put_hex(char *p, uint32_t value) {
+    int8_t shift;
+
+    for (shift = 28; shift >= 0; shift -= 4) {
+        *p++ = "0123456789ABCDEF"[(value >> shift) & 0xF];
+    }
+    return p;
+}
+
+/**
+ * @brief Send text over USART2 (blocking)
+ * The timeout is the time the text takes at PROF_UART_BAUD plus a margin,
+ * so a stalled UART holds the caller no longer than a working one.
+ */
+static void prof_send(const char *text, uint16_t len) {
+    HAL_UART_Transmit(&huart2, (uint8_t *)text, len, PROF_UART_MS(len) + 2u);
+}
+
+/**
+ * @brief Write a task name: T and the slot index, padded to 6 characters
+ * @return Pointer past the last written character
+ */
+static char *prof_put_task(char *p, uint8_t index) {
+    char *start = p;
+
+    *p++ = 'T';
+    if (index < 10) *p++ = '0';
+    p = prof_put_dec(p, index, 0);
+    while (p < start + 6) *p++ = ' ';
+    return p;
+}
+
+/**
+ * @brief Print one table row
+ */
+static void prof_print_row(const char *name, uint32_t address, const ProfStats *stats) {
+    char line[72];
+    char *p = line;
+
+    while (*name) *p++ = *name++;
+    p = prof_put_hex(p, address);
+    p = prof_put_dec(p, stats->count, 11);
+    p = prof_put_dec(p, stats->count ? stats->min : 0, 11);
+    p = prof_put_dec(p, stats->max, 11);
+    p = prof_put_dec(p, prof_mean(stats), 11);
+    *p++ = '\r';
+    *p++ = '\n';
+
+    prof_send(line, (uint16_t)(p - line));
+}
+
+/**
+ * @brief Print one release jitter row
+ */
+static void prof_print_jitter_row(const char *name, const sTaskJitter *jitter) {
+    char line[16 + 11 + 11 + SCH_HIST_BUCKETS * 6];
+    char *p = line;
+    uint8_t k;
+
+    while (*name) *p++ = *name++;
+    p = prof_put_dec(p, jitter->Missed, 10);
+    p = prof_put_dec(p, jitter->MaxLatency, 11);
+    for (k = 0; k < SCH_HIST_BUCKETS; k++) {
+        p = prof_put_dec(p, jitter->Bucket[k], 6);
+    }
+    *p++ = '\r';
+    *p++ = '\n';
+
+    prof_send(line, (uint16_t)(p - line));
+}
+
+/**
+ * @brief Print the LCD bus statistics row
+ */
+static void prof_print_lcd_row(void) {
+    static const char header[] = "\r\nLCD       SPEED  TRANSFERS      BYTES       BUSY     ERRORS   HEADLESS RECOVERIES   FAILURES\r\n";
+    char line[108];
+    char *p = line;
+    LcdBusStats stats;
+
+    lcd_get_bus_stats(&stats);
+    *p++ = ' ';
+    *p++ = ' ';
+    *p++ = ' ';
+    *p++ = ' ';
+    p = prof_put_dec(p, lcd_get_bus_speed(), 8);
+    p = prof_put_dec(p, stats.transfers, 11);
+    p = prof_put_dec(p, stats.bytes, 11);
+    p = prof_put_dec(p, stats.busy_cycles, 11);
+    p = prof_put_dec(p, stats.errors, 11);
+    p = prof_put_dec(p, stats.headless, 11);
+    p = prof_put_dec(p, stats.recoveries, 11);
+    p = prof_put_dec(p, stats.recover_failures, 11);
+    *p++ = '\r';
+    *p++ = '\n';
+
+    prof_send(header, sizeof(header) - 1);
+    prof_send(line, (uint16_t)(p - line));
+}
+
+/**
+ * @brief Print the statistics tables over USART2 (blocking)
+ * Execution times and latencies are in CPU cycles. Histogram column k
+ * counts releases that started less than 2^k x 64 cycles late.
+ * Runs only on request, from the lowest-priority task. It blocks for as
+ * long as the text takes on the wire: about 190 bytes per task slot in
+ * use, roughly 0.5 s for all 32 slots at 115200 baud. Releases delayed
+ * meanwhile show up in the jitter histograms of the next dump.
+ */
+void prof_dump(void) {
+    static const char header[] =
+        "\r\nTASK  FUNCTION      COUNT        MIN        MAX       MEAN\r\n";
+    static const char jitter_header[] =
+        "\r\nTASK      MISSED     MAXLAT  LATENCY HISTOGRAM (log2, 64-cycle units)\r\n";
+    char name[7];
+    void (*pTask)(void);
+    ProfStats stats;
+    sTaskJitter jitter;
+    uint8_t i;
+
+    prof_send(header, sizeof(header) - 1);
+
+    prof_get_isr_stats(&stats);
+    prof_print_row("TIM2  ", 0, &stats);
+
+    for (i = 0; i < SCH_MAX_TASKS; i++) {
+        if (!SCH_Get_Task_Stats(i, &pTask, &stats)) continue;
+        *prof_put_task(name, i) = '\0';
+        prof_print_row(name, (uint32_t)(uintptr_t)pTask, &stats);
+    }
+
+    prof_send(jitter_header, sizeof(jitter_header) - 1);
+    for (i = 0; i < SCH_MAX_TASKS; i++) {
+        if (!SCH_Get_Task_Jitter(i, &jitter)) continue;
+        *prof_put_task(name, i) = '\0';
+        prof_print_jitter_row(name, &jitter);
+    }
+
+    prof_print_lcd_row();
+}
@@ -2,14 +2,239 @@
  * sched.c
  * Task scheduler implementation
  * Cooperative multitasking scheduler with fixed time-slice execution
+ *
+ * Timing is tracked in a delta queue: SCH_Advance() (main loop, from
+ * timer_process()) only touches the head entry and moves due tasks onto
+ * the FIFO ready list of their priority. A 32-bit bitmap marks the non-empty ready lists (priority p is
+ * bit 31-p), so the dispatcher finds the highest ready priority with a
+ * single count-leading-zeros. The sorted re-insertion of periodic tasks is
+ * done by SCH_Dispatch_Tasks(), also in the main loop.
+ *
+ * Both kinds of list are doubly linked through slot indices, so a task is
+ * unlinked in O(1). Tasks are named by handles that carry the slot index
+ * and a per-slot generation, so lookups are O(1) and a handle to a deleted
+ * task never matches the slot's next occupant.
  */
 
 #include "sched.h"
 #include <string.h>
 
+// Critical section around list updates shared with SCH_Signal() (which may
+// run in an interrupt), and count-leading-zeros. Can be overridden before this file is compiled
+// (e.g. host benchmark).
+#ifndef SCH_ENTER_CRITICAL
+#include "stm32f1xx_hal.h"
+#define SCH_ENTER_CRITICAL()  __disable_irq()
+#define SCH_EXIT_CRITICAL()   __enable_irq()
+#define SCH_CLZ(x)            __CLZ(x)
+#endif
+
 // Task array
 static sTask SCH_tasks_G[SCH_MAX_TASKS];
-static uint32_t taskIDCounter = 0;
+
+#if PROF_ENABLE
+// Execution-time and release statistics, one record per task slot
+static ProfStats SCH_prof_G[SCH_MAX_TASKS];
+static sTaskJitter SCH_jitter_G[SCH_MAX_TASKS];
+
+// Cycle counter value when each task was released (due tick or signal)
+static uint32_t SCH_release_G[SCH_MAX_TASKS];
+
+// Cycles per 10ms tick, to date releases processed after their tick
+#ifndef SCH_TICK_CYCLES
+#define SCH_TICK_CYCLES  (SystemCoreClock / 100u)
+#endif
+#endif
+
+// Delta queue of waiting tasks, one FIFO of released tasks per priority
+static volatile uint8_t SCH_delta_head = SCH_NO_TASK;
+static volatile uint8_t SCH_ready_head[SCH_PRIORITIES];
+static volatile uint8_t SCH_ready_tail[SCH_PRIORITIES];
+
+// Bit 31-p is set while the ready list of priority p is not empty
+static volatile uint32_t SCH_ready_map = 0;
+
+#define SCH_PRIO_BIT(prio)  (0x80000000u >> (prio))
+
+// Ticks advanced since SCH_Init()
+static volatile uint32_t SCH_tick = 0;
+
+/**
+ * @brief Insert a task into the delta queue (call with interrupts disabled)
+ * @param index: Task slot
+ * @param ticks: Ticks from now until release (at least 1)
+ */
+static void SCH_Queue_Insert(uint8_t index, uint32_t ticks) {
+    uint8_t prev = SCH_NO_TASK;
+    uint8_t cur = SCH_delta_head;
+
+    // Walk past every entry due no later than this one (keeps FIFO order)
+    while (cur != SCH_NO_TASK && SCH_tasks_G[cur].Delay <= ticks) {
+        ticks -= SCH_tasks_G[cur].Delay;
+        prev = cur;
+        cur = SCH_tasks_G[cur].Next;
+    }
+
+    SCH_tasks_G[index].Delay = ticks;
+    SCH_tasks_G[index].Next = cur;
+    SCH_tasks_G[index].Prev = prev;
+    SCH_tasks_G[index].Queued = 1;
+    if (cur != SCH_NO_TASK) {
+        SCH_tasks_G[cur].Delay -= ticks;
+        SCH_tasks_G[cur].Prev = index;
+    }
+
+    if (prev == SCH_NO_TASK) {
+        SCH_delta_head = index;
+    } else {
+        SCH_tasks_G[prev].Next = index;
+    }
+}
+
+/**
+ * @brief Unlink a task from the delta queue (call with interrupts disabled)
+ * The remaining delay is handed to the successor.
+ * @param index: Queued task slot
+ */
+static void SCH_Queue_Remove(uint8_t index) {
+    uint8_t next = SCH_tasks_G[index].Next;
+    uint8_t prev = SCH_tasks_G[index].Prev;
+
+    if (next != SCH_NO_TASK) {
+        SCH_tasks_G[next].Delay += SCH_tasks_G[index].Delay;
+        SCH_tasks_G[next].Prev = prev;
+    }
+    if (prev == SCH_NO_TASK) {
+        SCH_delta_head = next;
+    } else {
+        SCH_tasks_G[prev].Next = next;
+    }
+    SCH_tasks_G[index].Next = SCH_NO_TASK;
+    SCH_tasks_G[index].Prev = SCH_NO_TASK;
+    SCH_tasks_G[index].Queued = 0;
+}
+
+/**
+ * @brief Append a released task to its ready list (interrupts disabled)
+ * @param index: Task slot
+ */
+static void SCH_Ready_Push(uint8_t index) {
+    uint8_t prio = SCH_tasks_G[index].Priority;
+
+    SCH_tasks_G[index].RunMe = 1;
+    SCH_tasks_G[index].Next = SCH_NO_TASK;
+    SCH_tasks_G[index].Prev = SCH_ready_tail[prio];
+    if (SCH_ready_tail[prio] == SCH_NO_TASK) {
+        SCH_ready_head[prio] = index;
+    } else {
+        SCH_tasks_G[SCH_ready_tail[prio]].Next = index;
+    }
+    SCH_ready_tail[prio] = index;
+    SCH_ready_map |= SCH_PRIO_BIT(prio);
+}
+
+/**
+ * @brief Unlink a task from its ready list (call with interrupts disabled)
+ * @param index: Ready task slot
+ */
+static void SCH_Ready_Remove(uint8_t index) {
+    uint8_t prio = SCH_tasks_G[index].Priority;
+    uint8_t next = SCH_tasks_G[index].Next;
+    uint8_t prev = SCH_tasks_G[index].Prev;
+
+    if (prev == SCH_NO_TASK) {
+        SCH_ready_head[prio] = next;
+    } else {
+        SCH_tasks_G[prev].Next = next;
+    }
+    if (next == SCH_NO_TASK) {
+        SCH_ready_tail[prio] = prev;
+    } else {
+        SCH_tasks_G[next].Prev = prev;
+    }
+    if (SCH_ready_head[prio] == SCH_NO_TASK) {
+        SCH_ready_map &= ~SCH_PRIO_BIT(prio);
+    }
+    SCH_tasks_G[index].Next = SCH_NO_TASK;
+    SCH_tasks_G[index].Prev = SCH_NO_TASK;
+    SCH_tasks_G[index].RunMe = 0;
+}
+
+/**
+ * @brief Unlink a task from whichever list holds it (interrupts disabled)
+ * @param index: Task slot
+ */
+static void SCH_Unlink(uint8_t index) {
+    if (SCH_tasks_G[index].Queued) {
+        SCH_Queue_Remove(index);
+    } else if (SCH_tasks_G[index].RunMe) {
+        SCH_Ready_Remove(index);
+    }
+}
+
+/**
+ * @brief Find the slot named by a task handle
+ * @param handle: Task handle
+ * @return Slot index, SCH_NO_TASK if the handle is invalid or stale
+ */
+static uint8_t SCH_Lookup(uint32_t handle) {
+    uint8_t index = SCH_HANDLE_SLOT(handle);
+
+    if (handle == SCH_INVALID_HANDLE || index >= SCH_MAX_TASKS) return SCH_NO_TASK;
+    if (SCH_tasks_G[index].Handle != handle) return SCH_NO_TASK;
+    return index;
+}
+
+/**
+ * @brief Take the oldest task of the highest ready priority (interrupts disabled)
+ * @return Task slot, SCH_NO_TASK if nothing is ready
+ */
+static uint8_t SCH_Ready_Pop(void) {
+    uint8_t prio;
+    uint8_t index;
+
+    if (SCH_ready_map == 0) return SCH_NO_TASK;
+
+    prio = (uint8_t)SCH_CLZ(SCH_ready_map);
+    index = SCH_ready_head[prio];
+    SCH_Ready_Remove(index);
+    return index;
+}
+
+/**
+ * @brief Clear a task slot (the generation is kept for the next occupant)
+ * @param index: Task slot
+ */
+static void SCH_Clear_Slot(uint8_t index) {
+    SCH_tasks_G[index].pTask = 0;
+    SCH_tasks_G[index].Delay = 0;
+    SCH_tasks_G[index].Period = 0;
+    SCH_tasks_G[index].Due = 0;
+    SCH_tasks_G[index].RunMe = 0;
+    SCH_tasks_G[index].Queued = 0;
+    SCH_tasks_G[index].Priority = SCH_PRIO_DEFAULT;
+    SCH_tasks_G[index].Event = 0;
+    SCH_tasks_G[index].Next = SCH_NO_TASK;
+    SCH_tasks_G[index].Prev = SCH_NO_TASK;
+    SCH_tasks_G[index].Handle = SCH_INVALID_HANDLE;
+}
+
+#if PROF_ENABLE
+/**
+ * @brief Add a release-to-start latency to the task histogram
+ * @param index: Task slot
+ * @param cycles: Latency in CPU cycles
+ */
+static void SCH_Record_Latency(uint8_t index, uint32_t cycles) {
+    sTaskJitter *jitter = &SCH_jitter_G[index];
+    uint32_t units = cycles >> SCH_HIST_SHIFT;
+    uint32_t bucket = units ? 32u - SCH_CLZ(units) : 0u;
+
+    if (bucket >= SCH_HIST_BUCKETS) bucket = SCH_HIST_BUCKETS - 1;
+    if (jitter->Bucket[bucket] != 0xFFFF) jitter->Bucket[bucket]++;
+    if (cycles > jitter->MaxLatency) jitter->MaxLatency = cycles;
+}
+#endif
 
 /**
  * @brief Initialize the scheduler
@@ -17,117 +242,453 @@ static uint32_t taskIDCounter = 0;
 void SCH_Init(void) {
     uint8_t i;
     for (i = 0; i < SCH_MAX_TASKS; i++) {
-        SCH_tasks_G[i].pTask = 0;
-        SCH_tasks_G[i].Delay = 0;
-        SCH_tasks_G[i].Period = 0;
-        SCH_tasks_G[i].RunMe = 0;
-        SCH_tasks_G[i].TaskID = 0;
+        SCH_Clear_Slot(i);
+        SCH_tasks_G[i].Generation = 0;
+    }
+    for (i = 0; i < SCH_PRIORITIES; i++) {
+        SCH_ready_head[i] = SCH_NO_TASK;
+        SCH_ready_tail[i] = SCH_NO_TASK;
     }
-    taskIDCounter = 0;
+    SCH_delta_head = SCH_NO_TASK;
+    SCH_ready_map = 0;
+    SCH_tick = 0;
+    SCH_Reset_Stats();
 }
 
 /**
- * @brief Add a task to the scheduler
+ * @brief Add a task to the scheduler with the default priority
  * @param pFunction: Pointer to the task function
  * @param DELAY: Initial delay before first execution (in ticks)
  * @param PERIOD: Period between repeated executions (in ticks, 0 for one-shot)
- * @return Task ID (0 if failed)
+ * @return Task handle (SCH_INVALID_HANDLE if failed)
  */
 uint32_t SCH_Add_Task(void (*pFunction)(), uint32_t DELAY, uint32_t PERIOD) {
+    return SCH_Add_Task_Priority(pFunction, DELAY, PERIOD, SCH_PRIO_DEFAULT);
+}
+
+/**
+ * @brief Fill a task slot and queue its first release
+ * @param Index: Empty task slot
+ * @param pFunction: Pointer to the task function
+ * @param DELAY: Initial delay in ticks (ignored for event tasks)
+ * @param PERIOD: Period in ticks (0 for one-shot and event tasks)
+ * @param PRIORITY: Dispatch priority
+ * @param EVENT: 1 if the task is only released by SCH_Signal()
+ */
+static void SCH_Fill_Slot(uint8_t Index, void (*pFunction)(), uint32_t DELAY,
+                          uint32_t PERIOD, uint8_t PRIORITY, uint8_t EVENT) {
+    SCH_tasks_G[Index].pTask = pFunction;
+    SCH_tasks_G[Index].Period = PERIOD;
+    SCH_tasks_G[Index].RunMe = 0;
+    SCH_tasks_G[Index].Priority = PRIORITY;
+    SCH_tasks_G[Index].Event = EVENT;
+#if PROF_ENABLE
+    prof_reset(&SCH_prof_G[Index]);
+    memset(&SCH_jitter_G[Index], 0, sizeof(sTaskJitter));
+#endif
+
+    if (EVENT) return;
+
+    // A delay of 0 releases the task on the next tick
+    SCH_ENTER_CRITICAL();
+    SCH_tasks_G[Index].Due = SCH_tick + DELAY + 1;
+    SCH_Queue_Insert(Index, DELAY + 1);
+    SCH_EXIT_CRITICAL();
+}
+
+/**
+ * @brief Claim an empty task slot and give it a new handle
+ * @return Slot index, SCH_NO_TASK if the table is full
+ */
+static uint8_t SCH_New_Slot(void) {
     uint8_t Index = 0;
-    
+
     // Find an empty slot
-    while ((SCH_tasks_G[Index].pTask != 0) && (Index < SCH_MAX_TASKS)) {
+    while ((Index < SCH_MAX_TASKS) && (SCH_tasks_G[Index].pTask != 0)) {
         Index++;
     }
-    
+
     // If no empty slot found
     if (Index == SCH_MAX_TASKS) {
-        return 0; // Failed to add task
+        return SCH_NO_TASK;
     }
-    
-    // Add task to the array
-    SCH_tasks_G[Index].pTask = pFunction;
-    SCH_tasks_G[Index].Delay = DELAY;
-    SCH_tasks_G[Index].Period = PERIOD;
-    SCH_tasks_G[Index].RunMe = 0;
-    
-    // Assign unique task ID
-    taskIDCounter++;
-    SCH_tasks_G[Index].TaskID = taskIDCounter;
-    
-    return taskIDCounter;
+
+    // Next generation of the slot (never 0, so a handle is never 0)
+    SCH_tasks_G[Index].Generation = (SCH_tasks_G[Index].Generation + 1u) & SCH_GEN_MASK;
+    if (SCH_tasks_G[Index].Generation == 0) {
+        SCH_tasks_G[Index].Generation = 1;
+    }
+    SCH_tasks_G[Index].Handle = SCH_HANDLE(Index, SCH_tasks_G[Index].Generation);
+
+    return Index;
 }
 
 /**
- * @brief Update the scheduler - called from timer ISR
- * Decrements delays and sets RunMe flag when delay reaches 0
+ * @brief Load a task table built at compile time (see task_manifest.h)
+ * Must be called right after SCH_Init(): entry i goes to slot i with handle
+ * SCH_HANDLE(i, 1), without searching for free slots. The table is
+ * validated when it is compiled, so loading cannot fail.
+ * @param table: Task table (const, in flash)
+ * @param count: Number of entries (at most SCH_MAX_TASKS)
  */
-void SCH_Update(void) {
+void SCH_Load_Table(const sTaskConfig *table, uint8_t count) {
     uint8_t Index;
-    
-    for (Index = 0; Index < SCH_MAX_TASKS; Index++) {
-        // Check if there is a task at this location
-        if (SCH_tasks_G[Index].pTask) {
-            if (SCH_tasks_G[Index].Delay > 0) {
-                // Decrement the delay
-                SCH_tasks_G[Index].Delay--;
+
+    for (Index = 0; Index < count; Index++) {
+        SCH_tasks_G[Index].Generation = 1;
+        SCH_tasks_G[Index].Handle = SCH_HANDLE(Index, 1);
+        SCH_Fill_Slot(Index, table[Index].pTask, table[Index].Delay, table[Index].Period,
+                      table[Index].Priority, table[Index].Event);
+    }
+}
+
+/**
+ * @brief Add a task to the scheduler
+ * @param pFunction: Pointer to the task function
+ * @param DELAY: Initial delay before first execution (in ticks)
+ * @param PERIOD: Period between repeated executions (in ticks, 0 for one-shot)
+ * @param PRIORITY: SCH_PRIO_HIGHEST (0) .. SCH_PRIO_LOWEST (31)
+ * @return Task handle (SCH_INVALID_HANDLE if failed)
+ */
+uint32_t SCH_Add_Task_Priority(void (*pFunction)(), uint32_t DELAY, uint32_t PERIOD,
+                               uint8_t PRIORITY) {
+    uint8_t Index;
+
+    if (PRIORITY >= SCH_PRIORITIES) return SCH_INVALID_HANDLE;
+
+    Index = SCH_New_Slot();
+    if (Index == SCH_NO_TASK) {
+        return SCH_INVALID_HANDLE; // Failed to add task
+    }
+    SCH_Fill_Slot(Index, pFunction, DELAY, PERIOD, PRIORITY, 0);
+
+    return SCH_tasks_G[Index].Handle;
+}
+
+/**
+ * @brief Add a task that only runs when signalled
+ * The task is not timed: it is released by SCH_Signal() and stays in the
+ * scheduler after running, until deleted.
+ * @param pFunction: Pointer to the task function
+ * @param PRIORITY: SCH_PRIO_HIGHEST (0) .. SCH_PRIO_LOWEST (31)
+ * @return Task handle (SCH_INVALID_HANDLE if failed)
+ */
+uint32_t SCH_Add_Event_Task(void (*pFunction)(), uint8_t PRIORITY) {
+    uint8_t Index;
+
+    if (PRIORITY >= SCH_PRIORITIES) return SCH_INVALID_HANDLE;
+
+    Index = SCH_New_Slot();
+    if (Index == SCH_NO_TASK) {
+        return SCH_INVALID_HANDLE; // Failed to add task
+    }
+    SCH_Fill_Slot(Index, pFunction, 0, 0, PRIORITY, 1);
+
+    return SCH_tasks_G[Index].Handle;
+}
+
+/**
+ * @brief Release an event task (safe to call from an interrupt)
+ * Signals arriving while the task is already ready are merged; a signal
+ * arriving while it runs releases it once more.
+ * @param handle: Handle returned by SCH_Add_Event_Task()
+ * @return 1 if the task was released, 0 if already ready or not found
+ */
+uint8_t SCH_Signal(uint32_t handle) {
+    uint8_t Index;
+    uint8_t released = 0;
+
+    SCH_ENTER_CRITICAL();
+    Index = SCH_Lookup(handle);
+    if (Index != SCH_NO_TASK && SCH_tasks_G[Index].Event && !SCH_tasks_G[Index].RunMe) {
+#if PROF_ENABLE
+        SCH_release_G[Index] = PROF_CYCLES();
+#endif
+        SCH_Ready_Push(Index);
+        released = 1;
+    }
+    SCH_EXIT_CRITICAL();
+
+    return released;
+}
+
+/**
+ * @brief Move the next release of a timed task
+ * The task is taken off the ready list if it was released but has not run
+ * yet. Calling this from the task itself replaces its periodic re-queue.
+ * @param handle: Task handle
+ * @param DELAY: Ticks before the next release (0 = next tick)
+ * @return 1 if successful, 0 if the handle is stale or names an event task
+ */
+uint8_t SCH_Reschedule_Task(uint32_t handle, uint32_t DELAY) {
+    uint8_t Index;
+    uint8_t done = 0;
+
+    SCH_ENTER_CRITICAL();
+    Index = SCH_Lookup(handle);
+    if (Index != SCH_NO_TASK && !SCH_tasks_G[Index].Event) {
+        SCH_Unlink(Index);
+        SCH_tasks_G[Index].Due = SCH_tick + DELAY + 1;
+        SCH_Queue_Insert(Index, DELAY + 1);
+        done = 1;
+    }
+    SCH_EXIT_CRITICAL();
+
+    return done;
+}
+
+/**
+ * @brief Change the period of a timed task in place
+ * The pending release is kept; the new period applies from that release on.
+ * Combine with SCH_Reschedule_Task() to move the pending release as well.
+ * @param handle: Task handle
+ * @param PERIOD: New period in ticks (0 makes the task one-shot)
+ * @return 1 if successful, 0 if the handle is stale or names an event task
+ */
+uint8_t SCH_Set_Period(uint32_t handle, uint32_t PERIOD) {
+    uint8_t Index;
+    uint8_t done = 0;
+
+    SCH_ENTER_CRITICAL();
+    Index = SCH_Lookup(handle);
+    if (Index != SCH_NO_TASK && !SCH_tasks_G[Index].Event) {
+        SCH_tasks_G[Index].Period = PERIOD;
+        done = 1;
+    }
+    SCH_EXIT_CRITICAL();
+
+    return done;
+}
+
+/**
+ * @brief Query a task
+ * @param handle: Task handle
+ * @param remaining: Output (optional), ticks until the next release: 0 if
+ *        released, 0xFFFFFFFF for an event task waiting for a signal
+ * @param period: Output (optional), current period in ticks
+ * @return 1 if the handle names a live task, 0 if it is stale or invalid
+ */
+uint8_t SCH_Get_Task_Info(uint32_t handle, uint32_t *remaining, uint32_t *period) {
+    uint8_t Index;
+    uint8_t found = 0;
+
+    SCH_ENTER_CRITICAL();
+    Index = SCH_Lookup(handle);
+    if (Index != SCH_NO_TASK) {
+        if (remaining != 0) {
+            if (SCH_tasks_G[Index].Queued) {
+                *remaining = SCH_tasks_G[Index].Due - SCH_tick;
+            } else if (SCH_tasks_G[Index].Event && !SCH_tasks_G[Index].RunMe) {
+                *remaining = 0xFFFFFFFFu;
             } else {
-                // Task is ready to run
-                SCH_tasks_G[Index].RunMe = 1;
-                
-                // Reset delay for periodic tasks
-                if (SCH_tasks_G[Index].Period > 0) {
-                    SCH_tasks_G[Index].Delay = SCH_tasks_G[Index].Period;
-                }
+                *remaining = 0;
             }
         }
+        if (period != 0) {
+            *period = SCH_tasks_G[Index].Period;
+        }
+        found = 1;
     }
+    SCH_EXIT_CRITICAL();
+
+    return found;
+}
+
+/**
+ * @brief Advance the scheduler by several ticks at once, ending now
+ * Decrements the head of the delta queue and moves due tasks to the ready
+ * lists
+ * @param ticks: Number of elapsed ticks
+ */
+void SCH_Advance(uint32_t ticks) {
+#if PROF_ENABLE
+    SCH_Advance_Stamped(ticks, PROF_CYCLES());
+#else
+    SCH_Advance_Stamped(ticks, 0);
+#endif
+}
+
+/**
+ * @brief Advance the scheduler by ticks counted earlier by the timer ISR
+ * Called from timer_process() in the main loop, with interrupts enabled.
+ * Each task is taken as released at its due tick, dated back from the
+ * stamp, so release latency includes any delay before this call.
+ * @param ticks: Number of elapsed ticks
+ * @param stamp: Cycle counter when the last of them was counted
+ */
+void SCH_Advance_Stamped(uint32_t ticks, uint32_t stamp) {
+    uint8_t Index;
+
+#if !PROF_ENABLE
+    (void)stamp;
+#endif
+    SCH_ENTER_CRITICAL();
+    SCH_tick += ticks;
+
+    Index = SCH_delta_head;
+    while (Index != SCH_NO_TASK && ticks > 0) {
+        if (SCH_tasks_G[Index].Delay > ticks) {
+            SCH_tasks_G[Index].Delay -= ticks;
+            break;
+        }
+        ticks -= SCH_tasks_G[Index].Delay;
+        SCH_tasks_G[Index].Delay = 0;
+
+        // Release every task that is now due
+        while (Index != SCH_NO_TASK && SCH_tasks_G[Index].Delay == 0) {
+            SCH_delta_head = SCH_tasks_G[Index].Next;
+            if (SCH_delta_head != SCH_NO_TASK) {
+                SCH_tasks_G[SCH_delta_head].Prev = SCH_NO_TASK;
+            }
+            SCH_tasks_G[Index].Queued = 0;
+#if PROF_ENABLE
+            // Due `ticks` ticks before the last counted one
+            SCH_release_G[Index] = stamp - ticks * SCH_TICK_CYCLES;
+#endif
+            SCH_Ready_Push(Index);
+
+            Index = SCH_delta_head;
+        }
+    }
+    SCH_EXIT_CRITICAL();
+}
+
+/**
+ * @brief Ticks until the next task release (call with interrupts disabled)
+ * @return 0 if a task is ready now, 0xFFFFFFFF if no task is queued
+ */
+uint32_t SCH_Next_Due(void) {
+    if (SCH_ready_map != 0) return 0;
+    if (SCH_delta_head == SCH_NO_TASK) return 0xFFFFFFFFu;
+    return SCH_tasks_G[SCH_delta_head].Delay;
 }
 
 /**
  * @brief Dispatch tasks - call from main loop
- * Executes tasks that are ready to run
+ * Executes released tasks, highest priority first (release order within a
+ * priority), and re-queues periodic ones. Priorities are re-checked after
+ * every task, so a task released meanwhile overtakes lower priorities.
  */
 void SCH_Dispatch_Tasks(void) {
     uint8_t Index;
-    
-    for (Index = 0; Index < SCH_MAX_TASKS; Index++) {
-        if (SCH_tasks_G[Index].RunMe > 0) {
-            // Run the task
-            (*SCH_tasks_G[Index].pTask)();
-            
-            // Reset RunMe flag
-            SCH_tasks_G[Index].RunMe = 0;
-            
-            // If one-shot task, delete it
-            if (SCH_tasks_G[Index].Period == 0) {
-                SCH_Delete_Task(SCH_tasks_G[Index].TaskID);
-            }
+    uint32_t handle;
+
+    for (;;) {
+        // Pop the highest-priority released task
+        SCH_ENTER_CRITICAL();
+        Index = SCH_Ready_Pop();
+        SCH_EXIT_CRITICAL();
+
+        if (Index == SCH_NO_TASK) break;
+
+        // Run the task
+        handle = SCH_tasks_G[Index].Handle;
+#if PROF_ENABLE
+        uint32_t start = PROF_CYCLES();
+        SCH_Record_Latency(Index, start - SCH_release_G[Index]);
+        (*SCH_tasks_G[Index].pTask)();
+        prof_record(&SCH_prof_G[Index], PROF_CYCLES() - start);
+#else
+        (*SCH_tasks_G[Index].pTask)();
+#endif
+
+        // Task deleted itself while running
+        if (SCH_tasks_G[Index].Handle != handle) continue;
+
+        // Event tasks wait for the next SCH_Signal(); a task that
+        // rescheduled itself is already queued
+        if (SCH_tasks_G[Index].Event || SCH_tasks_G[Index].Queued) continue;
+
+        // If one-shot task, delete it
+        if (SCH_tasks_G[Index].Period == 0) {
+            SCH_Clear_Slot(Index);
+            continue;
+        }
+
+        // Re-queue relative to the release tick so the period does not drift;
+        // releases that are already in the past are skipped
+        SCH_ENTER_CRITICAL();
+        uint32_t period = SCH_tasks_G[Index].Period;
+        uint32_t due = SCH_tasks_G[Index].Due + period;
+        if ((int32_t)(due - SCH_tick) <= 0) {
+            uint32_t skipped = (SCH_tick - due) / period + 1;
+            due += skipped * period;
+#if PROF_ENABLE
+            SCH_jitter_G[Index].Missed += skipped;
+#endif
         }
+        SCH_tasks_G[Index].Due = due;
+        SCH_Queue_Insert(Index, due - SCH_tick);
+        SCH_EXIT_CRITICAL();
     }
 }
 
 /**
  * @brief Delete a task from the scheduler
- * @param taskID: ID of the task to delete
- * @return 1 if successful, 0 if failed
+ * @param handle: Handle of the task to delete
+ * @return 1 if successful, 0 if the handle is stale or invalid
  */
-uint8_t SCH_Delete_Task(uint32_t taskID) {
+uint8_t SCH_Delete_Task(uint32_t handle) {
     uint8_t Index;
-    
-    // Find the task with the given ID
-    for (Index = 0; Index < SCH_MAX_TASKS; Index++) {
-        if (SCH_tasks_G[Index].TaskID == taskID) {
-            // Delete the task
-            SCH_tasks_G[Index].pTask = 0;
-            SCH_tasks_G[Index].Delay = 0;
-            SCH_tasks_G[Index].Period = 0;
-            SCH_tasks_G[Index].RunMe = 0;
-            SCH_tasks_G[Index].TaskID = 0;
-            return 1; // Success
-        }
+    uint8_t done = 0;
+
+    SCH_ENTER_CRITICAL();
+    Index = SCH_Lookup(handle);
+    if (Index != SCH_NO_TASK) {
+        SCH_Unlink(Index);
+        SCH_Clear_Slot(Index);
+        done = 1;
+    }
+    SCH_EXIT_CRITICAL();
+
+    return done;
+}
+
+/**
+ * @brief Get execution-time statistics of a task slot
+ * @param index: Task slot (0 .. SCH_MAX_TASKS-1)
+ * @param pTask: Output, task function in the slot
+ * @param stats: Output, statistics of the task (cycles)
+ * @return 1 if the slot holds a task, 0 otherwise
+ */
+uint8_t SCH_Get_Task_Stats(uint8_t index, void (**pTask)(void), ProfStats *stats) {
+    if (index >= SCH_MAX_TASKS || SCH_tasks_G[index].pTask == 0) return 0;
+
+    *pTask = SCH_tasks_G[index].pTask;
+#if PROF_ENABLE
+    *stats = SCH_prof_G[index];
+#else
+    prof_reset(stats);
+#endif
+    return 1;
+}
+
+/**
+ * @brief Get release jitter statistics of a task slot
+ * @param index: Task slot (0 .. SCH_MAX_TASKS-1)
+ * @param jitter: Output, latency histogram and missed releases
+ * @return 1 if the slot holds a task, 0 otherwise
+ */
+uint8_t SCH_Get_Task_Jitter(uint8_t index, sTaskJitter *jitter) {
+    if (index >= SCH_MAX_TASKS || SCH_tasks_G[index].pTask == 0) return 0;
+
+#if PROF_ENABLE
+    *jitter = SCH_jitter_G[index];
+#else
+    memset(jitter, 0, sizeof(sTaskJitter));
+#endif
+    return 1;
+}
+
+/**
+ * @brief Clear the execution-time and jitter statistics of all tasks
+ */
+void SCH_Reset_Stats(void) {
+#if PROF_ENABLE
+    uint8_t i;
+    for (i = 0; i < SCH_MAX_TASKS; i++) {
+        prof_reset(&SCH_prof_G[i]);
     }
-    
-    return 0; // Task not found
+    memset(SCH_jitter_G, 0, sizeof(SCH_jitter_G));
+#endif
 }
@@ -23,6 +23,10 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "timer.h"
+#include "prof.h"
+#include "stm32f1xx_ll_tim.h"
+#include "i2c-lcd.h"
+#include "button.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -56,6 +60,7 @@
 /* USER CODE END 0 */
 
 /* External variables --------------------------------------------------------*/
+extern I2C_HandleTypeDef hi2c1;
 extern TIM_HandleTypeDef htim2;
 /* USER CODE BEGIN EV */
 
@@ -205,7 +210,26 @@ void SysTick_Handler(void)
 void TIM2_IRQHandler(void)
 {
   /* USER CODE BEGIN TIM2_IRQn 0 */
-
+#if PROF_ENABLE
+  uint32_t start = PROF_CYCLES();
+#endif
+  // Only the update interrupt is enabled: acknowledge it and count the
+  // tick, bypassing the generic HAL flag decoding. The tick work itself
+  // runs from the main loop (timer_process()).
+  LL_TIM_ClearFlag_UPDATE(TIM2);
+#if PROF_ENABLE
+  timer_tick_cycles = start;
+#endif
+  timer_run();
+#if PROF_ENABLE
+  prof_record(&prof_tick_isr, PROF_CYCLES() - start);
+#endif
+  // Return before the generated HAL_TIM_IRQHandler() call below. CubeMX
+  // writes that call back outside the USER CODE blocks on every
+  // regeneration, so it is skipped here instead of deleted. It would only
+  // re-read the status flags (UPDATE is cleared already) and call no
+  // callback: HAL_TIM_PeriodElapsedCallback() is not used for TIM2.
+  return;
   /* USER CODE END TIM2_IRQn 0 */
   HAL_TIM_IRQHandler(&htim2);
   /* USER CODE BEGIN TIM2_IRQn 1 */
@@ -213,6 +237,34 @@ void TIM2_IRQHandler(void)
   /* USER CODE END TIM2_IRQn 1 */
 }
 
+/**
+  * @brief This function handles I2C1 event interrupt.
+  */
+void I2C1_EV_IRQHandler(void)
+{
+  /* USER CODE BEGIN I2C1_EV_IRQn 0 */
+
+  /* USER CODE END I2C1_EV_IRQn 0 */
+  HAL_I2C_EV_IRQHandler(&hi2c1);
+  /* USER CODE BEGIN I2C1_EV_IRQn 1 */
+
+  /* USER CODE END I2C1_EV_IRQn 1 */
+}
+
+/**
+  * @brief This function handles I2C1 error interrupt.
+  */
+void I2C1_ER_IRQHandler(void)
+{
+  /* USER CODE BEGIN I2C1_ER_IRQn 0 */
+
+  /* USER CODE END I2C1_ER_IRQn 0 */
+  HAL_I2C_ER_IRQHandler(&hi2c1);
+  /* USER CODE BEGIN I2C1_ER_IRQn 1 */
+
+  /* USER CODE END I2C1_ER_IRQn 1 */
+}
+
 /**
   * @brief This function handles EXTI line[15:10] interrupts.
   */
@@ -223,6 +275,9 @@ void EXTI15_10_IRQHandler(void)
   /* USER CODE END EXTI15_10_IRQn 0 */
   HAL_GPIO_EXTI_IRQHandler(B1_Pin);
   /* USER CODE BEGIN EXTI15_10_IRQn 1 */
+  // Button lines 10..15 share this vector with B1
+  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_10 | GPIO_PIN_11 | GPIO_PIN_12 |
+                           GPIO_PIN_14 | GPIO_PIN_15);
 
   /* USER CODE END EXTI15_10_IRQn 1 */
 }
@@ -230,15 +285,74 @@ void EXTI15_10_IRQHandler(void)
 /* USER CODE BEGIN 1 */
 
 /**
-  * @brief Timer period elapsed callback
-  * @param htim: Timer handle
+  * @brief EXTI line 0..4 and 9:5 interrupts (button wakeup, see button_init)
+  */
+void EXTI0_IRQHandler(void)
+{
+  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_0);
+}
+
+void EXTI1_IRQHandler(void)
+{
+  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_1);
+}
+
+void EXTI2_IRQHandler(void)
+{
+  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_2);
+}
+
+void EXTI3_IRQHandler(void)
+{
+  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_3);
+}
+
+void EXTI4_IRQHandler(void)
+{
+  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_4);
+}
+
+void EXTI9_5_IRQHandler(void)
+{
+  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_5 | GPIO_PIN_6 | GPIO_PIN_7 |
+                           GPIO_PIN_8 | GPIO_PIN_9);
+}
+
+/**
+  * @brief I2C master transmit complete callback
+  * @param hi2c: I2C handle
+  */
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+  if (hi2c->Instance == I2C1) {
+    // LCD frame sent: start the next queued one
+    lcd_tx_complete();
+  }
+}
+
+/**
+  * @brief I2C error callback
+  * @param hi2c: I2C handle
+  */
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+  if (hi2c->Instance == I2C1) {
+    lcd_tx_error();
+  }
+}
+
+/**
+  * @brief EXTI line detection callback
+  * @param GPIO_Pin: Pin that triggered the interrupt
   */
-void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
 {
-  if (htim->Instance == TIM2) {
-    // Call timer_run every 10ms
-	  SCH_Update();
-    timer_run();
+  if (GPIO_Pin == B1_Pin) {
+    // Blue user button: print profiling statistics over UART
+    prof_request_dump();
+  } else {
+    // Traffic light buttons: start a debounce burst
+    button_exti(GPIO_Pin);
   }
 }
 
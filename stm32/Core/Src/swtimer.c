@@ -0,0 +1,222 @@
+/*
+ * swtimer.c
+ * Software timer service implementation
+ *
+ * Level 0 holds timers due within the next SWT_SLOTS ticks, one slot per
+ * tick. Each higher level covers SWT_SLOTS times the range of the level
+ * below; whenever the level-0 index wraps, one slot of the next level is
+ * cascaded down. SWT_Advance() (from timer_process()) only advances the
+ * tick count, SWT_Dispatch() catches the wheel up and runs callbacks; both
+ * run in the main loop.
+ */
+
+#include "swtimer.h"
+
+// Wheel slots: singly linked lists with back-links for O(1) removal
+static sSoftTimer *SWT_wheel[SWT_LEVELS][SWT_SLOTS];
+
+// Ticks counted by SWT_Advance()
+static volatile uint32_t SWT_tick = 0;
+
+// Next tick to be processed by the wheel (lags SWT_tick until dispatched)
+static uint32_t SWT_wheel_time = 0;
+
+/**
+ * @brief Slot index of a timer tick at a given level
+ */
+#define SWT_INDEX(tick, level)  (((tick) >> ((level) * SWT_SLOT_BITS)) & SWT_SLOT_MASK)
+
+/**
+ * @brief Link a timer into the slot matching its expiry time
+ * @param timer: Timer to link (must not be linked)
+ */
+static void SWT_Link(sSoftTimer *timer) {
+    uint32_t delta = timer->Expires - SWT_wheel_time;
+    uint8_t level;
+    sSoftTimer **slot;
+
+    if ((int32_t)delta < 0) {
+        // Already due: process on the next wheel tick
+        slot = &SWT_wheel[0][SWT_wheel_time & SWT_SLOT_MASK];
+    } else {
+        if (delta > SWT_MAX_DELAY) {
+            delta = SWT_MAX_DELAY;
+            timer->Expires = SWT_wheel_time + delta;
+        }
+        level = 0;
+        while (delta >= (1u << ((level + 1) * SWT_SLOT_BITS))) {
+            level++;
+        }
+        slot = &SWT_wheel[level][SWT_INDEX(timer->Expires, level)];
+    }
+
+    timer->next = *slot;
+    if (timer->next) {
+        timer->next->pprev = &timer->next;
+    }
+    *slot = timer;
+    timer->pprev = slot;
+}
+
+/**
+ * @brief Unlink a timer from its slot
+ * @param timer: Timer to unlink (must be linked)
+ */
+static void SWT_Unlink(sSoftTimer *timer) {
+    *timer->pprev = timer->next;
+    if (timer->next) {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->next = 0;
+    timer->pprev = 0;
+}
+
+/**
+ * @brief Re-link every timer of one higher-level slot into lower levels
+ * @return Slot index that was cascaded (0 means the next level is due too)
+ */
+static uint32_t SWT_Cascade(uint8_t level) {
+    uint32_t index = SWT_INDEX(SWT_wheel_time, level);
+    sSoftTimer *timer = SWT_wheel[level][index];
+
+    SWT_wheel[level][index] = 0;
+    while (timer) {
+        sSoftTimer *next = timer->next;
+        timer->next = 0;
+        timer->pprev = 0;
+        SWT_Link(timer);
+        timer = next;
+    }
+    return index;
+}
+
+/**
+ * @brief Initialize the timer service (all timers are forgotten)
+ */
+void SWT_Init(void) {
+    uint8_t level;
+    uint8_t i;
+
+    for (level = 0; level < SWT_LEVELS; level++) {
+        for (i = 0; i < SWT_SLOTS; i++) {
+            SWT_wheel[level][i] = 0;
+        }
+    }
+    SWT_tick = 0;
+    SWT_wheel_time = 0;
+}
+
+/**
+ * @brief Start (or restart) a timer - call from main loop context
+ * @param timer: Caller-owned timer structure
+ * @param pCallback: Function called on expiry
+ * @param arg: Argument passed to the callback
+ * @param DELAY: Ticks until the first expiry
+ * @param PERIOD: Ticks between further expiries (0 for one-shot)
+ */
+void SWT_Start(sSoftTimer *timer, void (*pCallback)(void *), void *arg,
+               uint32_t DELAY, uint32_t PERIOD) {
+    if (timer->pprev) {
+        SWT_Unlink(timer);
+    }
+    timer->pCallback = pCallback;
+    timer->arg = arg;
+    timer->Period = PERIOD;
+    timer->Expires = SWT_tick + DELAY;
+    SWT_Link(timer);
+}
+
+/**
+ * @brief Stop a timer - call from main loop context
+ * @param timer: Timer to stop
+ * @return 1 if the timer was running, 0 otherwise
+ */
+uint8_t SWT_Stop(sSoftTimer *timer) {
+    if (!timer->pprev) return 0;
+    SWT_Unlink(timer);
+    return 1;
+}
+
+/**
+ * @brief Check if a timer is running
+ * @param timer: Timer to check
+ * @return 1 if the timer is running, 0 otherwise
+ */
+uint8_t SWT_Is_Active(const sSoftTimer *timer) {
+    return timer->pprev != 0;
+}
+
+/**
+ * @brief Get the current tick count of the timer service
+ * @return Ticks counted since SWT_Init()
+ */
+uint32_t SWT_Get_Tick(void) {
+    return SWT_tick;
+}
+
+/**
+ * @brief Count elapsed ticks (several at once after tickless idle)
+ * @param ticks: Number of elapsed ticks
+ */
+void SWT_Advance(uint32_t ticks) {
+    SWT_tick += ticks;
+}
+
+/**
+ * @brief Ticks until SWT_Dispatch() has work to do
+ * Scans at most one revolution of level 0; a level-0 wrap is reported as
+ * work because higher levels are cascaded there.
+ * @return 0 if the wheel is behind the tick count
+ */
+uint32_t SWT_Next_Expiry(void) {
+    uint32_t tick = SWT_tick;
+    uint32_t i;
+
+    if ((int32_t)(tick - SWT_wheel_time) >= 0) return 0;
+
+    for (i = 0; i < SWT_SLOTS; i++) {
+        uint32_t index = (SWT_wheel_time + i) & SWT_SLOT_MASK;
+        if (SWT_wheel[0][index] || index == 0) break;
+    }
+    return SWT_wheel_time + i - tick;
+}
+
+/**
+ * @brief Advance the wheel to the current tick and run expired callbacks
+ * Call from the main loop. Ticks missed while the loop was busy are
+ * processed in order, so periodic timers do not lose expiries.
+ */
+void SWT_Dispatch(void) {
+    while ((int32_t)(SWT_tick - SWT_wheel_time) >= 0) {
+        uint32_t index = SWT_wheel_time & SWT_SLOT_MASK;
+        sSoftTimer *expired;
+
+        // Level 0 wrapped: pull the next slots down from the higher levels
+        if (index == 0) {
+            uint8_t level = 1;
+            while (level < SWT_LEVELS && SWT_Cascade(level) == 0) {
+                level++;
+            }
+        }
+
+        // Detach the due slot so callbacks can start/stop timers freely
+        expired = SWT_wheel[0][index];
+        SWT_wheel[0][index] = 0;
+        if (expired) {
+            expired->pprev = &expired;
+        }
+        SWT_wheel_time++;
+
+        while (expired) {
+            sSoftTimer *timer = expired;
+            SWT_Unlink(timer);
+
+            // Re-arm periodic timers before the callback, which may stop them
+            if (timer->Period > 0) {
+                timer->Expires += timer->Period;
+                SWT_Link(timer);
+            }
+            timer->pCallback(timer->arg);
+        }
+    }
+}
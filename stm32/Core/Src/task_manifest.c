@@ -0,0 +1,27 @@
+/*
+ * task_manifest.c
+ * Task table built from TASK_MANIFEST and checked at compile time
+ */
+
+#include "task_manifest.h"
+#include "fsm.h"
+#include "prof.h"
+
+// Reject invalid entries when building instead of failing at startup
+#define TASK_CHECK(name, function, delay, period, priority, event) \
+    _Static_assert((priority) < SCH_PRIORITIES, #name ": priority out of range"); \
+    _Static_assert(!(event) || ((delay) == 0 && (period) == 0), \
+                   #name ": event tasks take no delay or period"); \
+    _Static_assert((period) == 0 || (delay) <= (period), \
+                   #name ": offset longer than the period");
+TASK_MANIFEST(TASK_CHECK)
+#undef TASK_CHECK
+
+_Static_assert(TASK_COUNT <= SCH_MAX_TASKS, "too many tasks for SCH_MAX_TASKS");
+
+#define TASK_ENTRY(name, function, delay, period, priority, event) \
+    [TASK_##name] = { function, delay, period, priority, event },
+const sTaskConfig task_table[TASK_COUNT] = {
+    TASK_MANIFEST(TASK_ENTRY)
+};
+#undef TASK_ENTRY
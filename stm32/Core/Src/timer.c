@@ -2,11 +2,18 @@
  * timer.c
  * Timer interrupt handling implementation
  * TIM2 is configured to trigger every 10ms
+ *
+ * The TIM2 interrupt only counts ticks (timer_run()). Debouncing and the
+ * scheduler/software timer bookkeeping run from the main loop in
+ * timer_process(), which catches up on all ticks counted since its last
+ * pass, so the interrupt stays short and never delays other interrupts.
  */
 
 #include "timer.h"
 #include "sched.h"
 #include "button.h"
+#include "matrix.h"
+#include "swtimer.h"
 
 // Timer flags
 uint8_t timer_flag_10ms = 0;
@@ -15,6 +22,15 @@ uint8_t timer_flag_1s = 0;
 // Timer counter for 1 second (100 * 10ms = 1s)
 uint16_t timer_counter_1s = 0;
 
+// Ticks counted by the interrupt, and ticks covered by the next interrupt
+// (more than 1 in tickless idle)
+volatile uint32_t timer_ticks = 0;
+volatile uint32_t timer_period_ticks = 1;
+volatile uint32_t timer_tick_cycles = 0;
+
+// Ticks already handed to timer_advance()
+static uint32_t timer_processed = 0;
+
 /**
  * @brief Initialize timer variables
  */
@@ -22,30 +38,86 @@ void timer_init(void) {
     timer_flag_10ms = 0;
     timer_flag_1s = 0;
     timer_counter_1s = 0;
+    timer_ticks = 0;
+    timer_period_ticks = 1;
+    timer_processed = 0;
+}
+
+/**
+ * @brief Process the ticks counted since the last call - call from the main loop
+ */
+void timer_process(void) {
+    uint32_t now, stamp;
+
+    // Tick count and the cycle stamp of its interrupt, read as a pair
+    do {
+        now = timer_ticks;
+        stamp = timer_tick_cycles;
+    } while (now != timer_ticks);
+
+    if (now == timer_processed) return;
+
+    timer_advance(now - timer_processed, stamp);
+    timer_processed = now;
+}
+
+/**
+ * @brief Number of counted ticks not processed yet
+ * @return Ticks waiting for timer_process()
+ */
+uint32_t timer_pending(void) {
+    return timer_ticks - timer_processed;
+}
+
+/**
+ * @brief Credit ticks that elapsed without a timer interrupt
+ * Called with interrupts disabled after an early wakeup from tickless idle
+ * @param ticks: Number of elapsed 10ms ticks
+ */
+void timer_add_ticks(uint32_t ticks) {
+#if PROF_ENABLE
+    timer_tick_cycles = PROF_CYCLES();
+#endif
+    timer_ticks += ticks;
 }
 
 /**
- * @brief Timer interrupt handler - called every 10ms
- * This function is called from HAL_TIM_PeriodElapsedCallback
+ * @brief Account for elapsed ticks
+ * @param ticks: Number of elapsed 10ms ticks
+ * @param stamp: Cycle counter when the last of them was counted
  */
-void timer_run(void) {
+void timer_advance(uint32_t ticks, uint32_t stamp) {
     // Set 10ms flag
     timer_flag_10ms = 1;
     
-    // Update button states (debouncing)
+    // Update button and input matrix states (debouncing). The inputs are
+    // sampled once per pass: a sample taken after a gap does not count as
+    // stable for the whole gap.
     button_reading();
+    matrix_scan();
     
     // Run scheduler
-    SCH_Update();
+    SCH_Advance_Stamped(ticks, stamp);
+    
+    // Advance software timer tick
+    SWT_Advance(ticks);
     
     // Count to 1 second
-    timer_counter_1s++;
-    if (timer_counter_1s >= 100) { // 100 * 10ms = 1s
-        timer_counter_1s = 0;
+    timer_counter_1s += ticks;
+    while (timer_counter_1s >= 100) { // 100 * 10ms = 1s
+        timer_counter_1s -= 100;
         timer_flag_1s = 1;
     }
 }
 
+/**
+ * @brief Set how many ticks the next timer interrupt represents
+ * @param ticks: Ticks covered by the current (stretched) timer period
+ */
+void timer_set_period_ticks(uint32_t ticks) {
+    timer_period_ticks = ticks;
+}
+
 /**
  * @brief Set a timer flag after a duration
  * @param flag: Pointer to the timer flag
@@ -6,47 +6,71 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
 ../Core/Src/button.c \
+../Core/Src/debounce.c \
 ../Core/Src/fsm.c \
 ../Core/Src/global.c \
 ../Core/Src/i2c-lcd.c \
+../Core/Src/idle.c \
+../Core/Src/input_event.c \
+../Core/Src/lcd_text.c \
 ../Core/Src/light.c \
 ../Core/Src/main.c \
+../Core/Src/matrix.c \
+../Core/Src/prof.c \
 ../Core/Src/sched.c \
 ../Core/Src/stm32f1xx_hal_msp.c \
 ../Core/Src/stm32f1xx_it.c \
+../Core/Src/swtimer.c \
 ../Core/Src/syscalls.c \
 ../Core/Src/sysmem.c \
 ../Core/Src/system_stm32f1xx.c \
+../Core/Src/task_manifest.c \
 ../Core/Src/timer.c 
 
 OBJS += \
 ./Core/Src/button.o \
+./Core/Src/debounce.o \
 ./Core/Src/fsm.o \
 ./Core/Src/global.o \
 ./Core/Src/i2c-lcd.o \
+./Core/Src/idle.o \
+./Core/Src/input_event.o \
+./Core/Src/lcd_text.o \
 ./Core/Src/light.o \
 ./Core/Src/main.o \
+./Core/Src/matrix.o \
+./Core/Src/prof.o \
 ./Core/Src/sched.o \
 ./Core/Src/stm32f1xx_hal_msp.o \
 ./Core/Src/stm32f1xx_it.o \
+./Core/Src/swtimer.o \
 ./Core/Src/syscalls.o \
 ./Core/Src/sysmem.o \
 ./Core/Src/system_stm32f1xx.o \
+./Core/Src/task_manifest.o \
 ./Core/Src/timer.o 
 
 C_DEPS += \
 ./Core/Src/button.d \
+./Core/Src/debounce.d \
 ./Core/Src/fsm.d \
 ./Core/Src/global.d \
 ./Core/Src/i2c-lcd.d \
+./Core/Src/idle.d \
+./Core/Src/input_event.d \
+./Core/Src/lcd_text.d \
 ./Core/Src/light.d \
 ./Core/Src/main.d \
+./Core/Src/matrix.d \
+./Core/Src/prof.d \
 ./Core/Src/sched.d \
 ./Core/Src/stm32f1xx_hal_msp.d \
 ./Core/Src/stm32f1xx_it.d \
+./Core/Src/swtimer.d \
 ./Core/Src/syscalls.d \
 ./Core/Src/sysmem.d \
 ./Core/Src/system_stm32f1xx.d \
+./Core/Src/task_manifest.d \
 ./Core/Src/timer.d 
 
 
@@ -57,7 +81,7 @@ Core/Src/%.o Core/Src/%.su Core/Src/%.cyclo: ../Core/Src/%.c Core/Src/subdir.mk
 clean: clean-Core-2f-Src
 
 clean-Core-2f-Src:
-	-$(RM) ./Core/Src/button.cyclo ./Core/Src/button.d ./Core/Src/button.o ./Core/Src/button.su ./Core/Src/fsm.cyclo ./Core/Src/fsm.d ./Core/Src/fsm.o ./Core/Src/fsm.su ./Core/Src/global.cyclo ./Core/Src/global.d ./Core/Src/global.o ./Core/Src/global.su ./Core/Src/i2c-lcd.cyclo ./Core/Src/i2c-lcd.d ./Core/Src/i2c-lcd.o ./Core/Src/i2c-lcd.su ./Core/Src/light.cyclo ./Core/Src/light.d ./Core/Src/light.o ./Core/Src/light.su ./Core/Src/main.cyclo ./Core/Src/main.d ./Core/Src/main.o ./Core/Src/main.su ./Core/Src/sched.cyclo ./Core/Src/sched.d ./Core/Src/sched.o ./Core/Src/sched.su ./Core/Src/stm32f1xx_hal_msp.cyclo ./Core/Src/stm32f1xx_hal_msp.d ./Core/Src/stm32f1xx_hal_msp.o ./Core/Src/stm32f1xx_hal_msp.su ./Core/Src/stm32f1xx_it.cyclo ./Core/Src/stm32f1xx_it.d ./Core/Src/stm32f1xx_it.o ./Core/Src/stm32f1xx_it.su ./Core/Src/syscalls.cyclo ./Core/Src/syscalls.d ./Core/Src/syscalls.o ./Core/Src/syscalls.su ./Core/Src/sysmem.cyclo ./Core/Src/sysmem.d ./Core/Src/sysmem.o ./Core/Src/sysmem.su ./Core/Src/system_stm32f1xx.cyclo ./Core/Src/system_stm32f1xx.d ./Core/Src/system_stm32f1xx.o ./Core/Src/system_stm32f1xx.su ./Core/Src/timer.cyclo ./Core/Src/timer.d ./Core/Src/timer.o ./Core/Src/timer.su
+	-$(RM) ./Core/Src/button.cyclo ./Core/Src/button.d ./Core/Src/button.o ./Core/Src/button.su ./Core/Src/debounce.cyclo ./Core/Src/debounce.d ./Core/Src/debounce.o ./Core/Src/debounce.su ./Core/Src/fsm.cyclo ./Core/Src/fsm.d ./Core/Src/fsm.o ./Core/Src/fsm.su ./Core/Src/global.cyclo ./Core/Src/global.d ./Core/Src/global.o ./Core/Src/global.su ./Core/Src/i2c-lcd.cyclo ./Core/Src/i2c-lcd.d ./Core/Src/i2c-lcd.o ./Core/Src/i2c-lcd.su ./Core/Src/idle.cyclo ./Core/Src/idle.d ./Core/Src/idle.o ./Core/Src/idle.su ./Core/Src/input_event.cyclo ./Core/Src/input_event.d ./Core/Src/input_event.o ./Core/Src/input_event.su ./Core/Src/lcd_text.cyclo ./Core/Src/lcd_text.d ./Core/Src/lcd_text.o ./Core/Src/lcd_text.su ./Core/Src/light.cyclo ./Core/Src/light.d ./Core/Src/light.o ./Core/Src/light.su ./Core/Src/main.cyclo ./Core/Src/main.d ./Core/Src/main.o ./Core/Src/main.su ./Core/Src/matrix.cyclo ./Core/Src/matrix.d ./Core/Src/matrix.o ./Core/Src/matrix.su ./Core/Src/prof.cyclo ./Core/Src/prof.d ./Core/Src/prof.o ./Core/Src/prof.su ./Core/Src/sched.cyclo ./Core/Src/sched.d ./Core/Src/sched.o ./Core/Src/sched.su ./Core/Src/stm32f1xx_hal_msp.cyclo ./Core/Src/stm32f1xx_hal_msp.d ./Core/Src/stm32f1xx_hal_msp.o ./Core/Src/stm32f1xx_hal_msp.su ./Core/Src/stm32f1xx_it.cyclo ./Core/Src/stm32f1xx_it.d ./Core/Src/stm32f1xx_it.o ./Core/Src/stm32f1xx_it.su ./Core/Src/swtimer.cyclo ./Core/Src/swtimer.d ./Core/Src/swtimer.o ./Core/Src/swtimer.su ./Core/Src/syscalls.cyclo ./Core/Src/syscalls.d ./Core/Src/syscalls.o ./Core/Src/syscalls.su ./Core/Src/sysmem.cyclo ./Core/Src/sysmem.d ./Core/Src/sysmem.o ./Core/Src/sysmem.su ./Core/Src/system_stm32f1xx.cyclo ./Core/Src/system_stm32f1xx.d ./Core/Src/system_stm32f1xx.o ./Core/Src/system_stm32f1xx.su ./Core/Src/task_manifest.cyclo ./Core/Src/task_manifest.d ./Core/Src/task_manifest.o ./Core/Src/task_manifest.su ./Core/Src/timer.cyclo ./Core/Src/timer.d ./Core/Src/timer.o ./Core/Src/timer.su
 
 .PHONY: clean-Core-2f-Src
 